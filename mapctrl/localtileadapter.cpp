@@ -0,0 +1,60 @@
+﻿#include "localtileadapter.hpp"
+
+CLocalTileAdapter::CLocalTileAdapter (QStringList const & fileNames, QString const & name, int tileSize,
+                                      int zoomMin, int zoomMax, bool swapCoordinates) :
+  CTileAdapter (fileNames, name, tileSize, zoomMin, zoomMax, swapCoordinates, NoDiskCache)
+{
+  m_keepEncoded = false; // The files are read by the workers, the data never reach the adapter.
+
+  // The tile state must be updated before the decoded tile is stored.
+  disconnect (&m_decoder, &CTileDecoder::tileDecoded, this, &CTileAdapter::tileDecoded);
+  connect (&m_decoder, &CTileDecoder::tileDecoded, this, &CLocalTileAdapter::fileDecoded);
+}
+
+QString CLocalTileAdapter::fileName (TTileKey key)
+{
+  QString name = url (tileKeyX (key), tileKeyY (key), tileKeyZ (key), tileKeyIndex (key));
+  if (name.startsWith (QLatin1String ("file:")))
+  {
+    name = QUrl (name).toLocalFile ();
+  }
+
+  return name;
+}
+
+void CLocalTileAdapter::requestTile (TTileKey key, CTileScheduler::EPriority priority)
+{
+  if (tileKeyIndex (key) < m_urls.size ())
+  {
+    m_decoder.decodeFile (key, fileName (key), m_imageFormat, priority == CTileScheduler::Visible ? 1 : 0);
+  }
+  else
+  {
+    tileMissing (key);
+  }
+}
+
+QByteArray CLocalTileAdapter::cachedData (TTileKey key)
+{
+  // Not read in the GUI thread. Without data, the tile is forgotten and requested again.
+  Q_UNUSED (key)
+  return QByteArray ();
+}
+
+void CLocalTileAdapter::fileDecoded (TTileKey key, QImage const & image)
+{
+  STile* tile = m_tiles.find (key);
+  if (tile != nullptr)
+  {
+    if (!image.isNull ())
+    {
+      tile->m_failures = 0;
+      tile->m_state    = STile::Available;
+      tileDecoded (key, image);
+    }
+    else
+    {
+      tileMissing (key);
+    }
+  }
+}
@@ -0,0 +1,42 @@
+﻿#ifndef LOCALTILEADAPTER_HPP
+#define LOCALTILEADAPTER_HPP
+
+#include "tileadapter.hpp"
+
+/*! \brief The CLocalTileAdapter class used to read tiles from a directory tree (e.g. <dir>/z/x/y.png).
+ *
+ *  The file names are built from templates like the urls of the tile servers,
+ *  %1=z, %2=x, %3=y (or %1=z, %2=y, %3=x with swapCoordinates). A template can be a path or a file url.
+ *  No network request is sent and no disk cache is created. The files are read and decoded
+ *  by the workers of the decoder, the visible tiles first. The image format is given by the
+ *  extension of the template, the vector tiles (.pbf, .mvt) are drawn with the vector tile style.
+ *  Missing files are not read again. A tile removed from the memory cache is read again from its file.
+ */
+class CLocalTileAdapter : public CTileAdapter
+{
+  Q_OBJECT
+public:
+  /*! Constructor.
+   *  \param fileNames: The file name templates (e.g. /data/osm/%1/%2/%3.png), one per url index.
+   *  \param name: The name of the adapter.
+   *  \param tileSize: The size of the tiles in pixels.
+   *  \param zoomMin: The minimum zoom of the files.
+   *  \param zoomMax: The maximum zoom of the files.
+   *  \param swapCoordinates: true for the trees with %1=z, %2=y, %3=x.
+   */
+  CLocalTileAdapter (QStringList const & fileNames, QString const & name = "local", int tileSize = 256,
+                     int zoomMin = 0, int zoomMax = 19, bool swapCoordinates = false);
+
+  /*! Returns the file name of the tile. */
+  QString fileName (TTileKey key);
+
+protected:
+  void requestTile (TTileKey key, CTileScheduler::EPriority priority) override;
+  QByteArray cachedData (TTileKey key) override;
+
+protected slots:
+  /*! The file is read and decoded. The tile is available or missing. */
+  void fileDecoded (TTileKey key, QImage const & image);
+};
+
+#endif // LOCALTILEADAPTER_HPP
@@ -29,19 +29,19 @@ public:
   int width () const { return m_width; }
 
   /*! Sets the pen width in pixels. */
-  void setWidth (int width) { m_width = width; }
+  void setWidth (int width) { m_width = width; changed (); }
 
   /*! Returns the center. */
   TGeoCoord center () const { return m_coordinates; }
 
   /*! Sets the center. */
-  void setCenter (TGeoCoord const & center) { m_coordinates = center; }
+  void setCenter (TGeoCoord const & center) { m_coordinates = center; changed (); }
 
   /*! Returns the radius in meters. */
   TCoordType radius () const { return m_radius; }
 
   /*! Sets the radius in meters. */
-  void setRadius (TCoordType radius) { m_radius = radius; }
+  void setRadius (TCoordType radius) { m_radius = radius; changed (); }
 
   /*! See the same functions on the base class. */
   void draw (QPainter* painter, CTileAdapter* tileAdapter, SViewportToWidget const & vt) const override;
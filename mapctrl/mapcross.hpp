@@ -34,13 +34,13 @@ public:
   int width () const { return m_width; }
 
   /*! Sets the width. */
-  void setWidth (int width) { m_width = width; }
+  void setWidth (int width) { m_width = width; changed (); }
 
   /*! Returns the height. */
   int height () const { return m_height; }
 
   /*! Sets the height. */
-  void setHeight (int height) { m_height = height; }
+  void setHeight (int height) { m_height = height; changed (); }
 
   /*! See the base class. */
   void draw (QPainter* painter, CTileAdapter* tileAdapter, SViewportToWidget const & vt) const override;
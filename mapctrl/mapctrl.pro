@@ -1,5 +1,5 @@
-QT -= gui
-QT += widgets network
+﻿QT -= gui
+QT += widgets network sql
 
 TEMPLATE = lib
 CONFIG += staticlib
@@ -10,6 +10,7 @@ include(../optimize.pri)
 
 SOURCES += \
     esritileadapter.cpp \
+    localtileadapter.cpp \
     mapboxtileadapter.cpp \
     mapcircle.cpp \
     mapcross.cpp \
@@ -20,11 +21,22 @@ SOURCES += \
     maptext.cpp \
     maptooltip.cpp \
     mapwidget.cpp \
+    mbtilesadapter.cpp \
     osmtileadapter.cpp \
-    tileadapter.cpp
+    projectedpaths.cpp \
+    simulatedtileadapter.cpp \
+    tileadapter.cpp \
+    tilecache.cpp \
+    tiledecoder.cpp \
+    tilediskcache.cpp \
+    tilepack.cpp \
+    tilepackadapter.cpp \
+    tilescheduler.cpp \
+    vectortile.cpp
 
 HEADERS += \
     esritileadapter.hpp \
+    localtileadapter.hpp \
     mapanchoredlocation.hpp \
     mapboxtileadapter.hpp \
     mapcircle.hpp \
@@ -37,8 +49,19 @@ HEADERS += \
     maptext.hpp \
     maptooltip.hpp \
     mapwidget.hpp \
+    mbtilesadapter.hpp \
     osmtileadapter.hpp \
-    tileadapter.hpp
+    projectedpaths.hpp \
+    simulatedtileadapter.hpp \
+    tileadapter.hpp \
+    tilecache.hpp \
+    tiledecoder.hpp \
+    tilediskcache.hpp \
+    tilekey.hpp \
+    tilepack.hpp \
+    tilepackadapter.hpp \
+    tilescheduler.hpp \
+    vectortile.hpp
 
 LIBNAME = tools
 include(../pretargetdeps.pri)
@@ -38,13 +38,14 @@ public:
   QPixmap const & image () const { return m_pixmap; }
 
   /*! Sets the pixmap. */
-  void setImage (QPixmap const & image) { m_pixmap = image; }
+  void setImage (QPixmap const & image) { m_pixmap = image; changed (); }
 
   /*! See the base class. */
   void draw (QPainter* painter, CTileAdapter* tileAdapter, SViewportToWidget const & vt) const override;
   bool isVisible (CAabb const &) const override;
   bool contains (TGeoCoord const & coords, TCoordType dx = 0, TCoordType dy = 0) const override;
   CAabb aabb (TCoordType dx, TCoordType dy) const override;
+  bool drawableInThread () const override { return false; } // QPixmap is used only in the GUI thread.
 
 protected:
   QPixmap m_pixmap;
@@ -28,7 +28,7 @@ public:
   TGeoCoord const & coordinates () const { return m_coordinates; }
 
   /*! Sets the location. */
-  void setCoordinates (TGeoCoord const & coordinates) { m_coordinates = coordinates; }
+  void setCoordinates (TGeoCoord const & coordinates) { m_coordinates = coordinates; changed (); }
 
 protected:
   TGeoCoord m_coordinates; //!< The location in WGS84 datum.
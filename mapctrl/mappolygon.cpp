@@ -1,6 +1,7 @@
 ﻿#include "mappolygon.hpp"
 #include "tileadapter.hpp"
 #include <QPainter>
+#include <QPainterPath>
 
 CMapPolygon::CMapPolygon (TPaths const & paths, TMapShapeId id) : CMapShape (Polygon, id), m_paths (paths)
 {
@@ -11,6 +12,8 @@ CMapPolygon::CMapPolygon (TPaths const & paths, TMapShapeId id) : CMapShape (Pol
       m_aabb.add (vertex);
     }
   }
+
+  m_projection.reset (m_paths);
 }
 
 int CMapPolygon::vertexCount () const
@@ -35,19 +38,146 @@ void CMapPolygon::draw (QPainter* painter, CTileAdapter* tileAdapter, SViewportT
   {
     updatePen (painter, m_borderColor, m_borderWidth);
     updateBrush (painter, m_color);
+    QPainterPath path;
+    path.setFillRule (Qt::WindingFill);
+    drawGeometry (painter, path, tileAdapter, vt);
+    if (!path.isEmpty ())
+    {
+      painter->drawPath (path);
+    }
+  }
+}
+
+bool CMapPolygon::batchStyle (SStyle& style) const
+{
+  style.m_penColor   = m_borderColor;
+  style.m_penWidth   = m_borderWidth;
+  style.m_brushColor = m_color;
+  return true;
+}
 
-    QPolygonF polygon;
-    polygon.reserve (vertexCount ());
-    for (TPath const & path : m_paths)
+void CMapPolygon::prepareDraw (CTileAdapter* tileAdapter, SViewportToWidget const & vt) const
+{
+  m_projection.paths (m_paths, tileAdapter, vt.m_zoom);
+}
+
+void CMapPolygon::drawGeometry (QPainter* painter, QPainterPath& path, CTileAdapter* tileAdapter, SViewportToWidget const & vt) const
+{
+  QRectF    rect = drawingRect (painter, m_borderWidth + 1);
+  QPolygonF polygon, clipped, dots;
+  for (QPolygon const & ring : m_projection.paths (m_paths, tileAdapter, vt.m_zoom))
+  {
+    if (ring.size () >= 3)
     {
       polygon.clear ();
-      for (TGeoCoord const & vertex : path)
+      polygon.reserve (ring.size ());
+      for (QPoint const & point : ring)
+      {
+        polygon.append (QPointF (vt.toWidget (point)));
+      }
+
+      // Only the visible geometry is given to QPainter.
+      QRectF bounds = polygon.boundingRect ();
+      if (rect.contains (bounds))
+      {
+        path.addPolygon (polygon);
+        path.closeSubpath ();
+      }
+      else if (rect.intersects (bounds))
+      {
+        clip (polygon, rect, clipped);
+        if (clipped.size () >= 3)
+        {
+          path.addPolygon (clipped);
+          path.closeSubpath ();
+        }
+      }
+    }
+    else if (!ring.isEmpty ())
+    { // Smaller than a pixel at this zoom.
+      QPointF dot = vt.toWidget (ring.first ());
+      if (rect.contains (dot))
+      {
+        dots.append (dot);
+      }
+    }
+  }
+
+  if (!dots.isEmpty ())
+  { // The dots are filled to keep the pen and the brush of the batch.
+    QColor color = QColor::fromRgba (qAlpha (m_color) != 0 ? m_color : m_borderColor);
+    for (QPointF const & dot : qAsConst (dots))
+    {
+      painter->fillRect (QRectF (dot, QSizeF (1, 1)), color);
+    }
+  }
+}
+
+// Edges of the clip rectangle.
+enum EEdge { Left, Right, Top, Bottom };
+
+static bool inside (QPointF const & p, QRectF const & rect, EEdge edge)
+{
+  switch (edge)
+  {
+    case Left :
+      return p.x () >= rect.left ();
+
+    case Right :
+      return p.x () <= rect.right ();
+
+    case Top :
+      return p.y () >= rect.top ();
+
+    default :
+      return p.y () <= rect.bottom ();
+  }
+}
+
+static QPointF intersection (QPointF const & a, QPointF const & b, QRectF const & rect, EEdge edge)
+{
+  // a and b are on either side of the edge, the denominator is not null.
+  if (edge == Left || edge == Right)
+  {
+    qreal x = edge == Left ? rect.left () : rect.right ();
+    return QPointF (x, a.y () + (b.y () - a.y ()) * (x - a.x ()) / (b.x () - a.x ()));
+  }
+
+  qreal y = edge == Top ? rect.top () : rect.bottom ();
+  return QPointF (a.x () + (b.x () - a.x ()) * (y - a.y ()) / (b.y () - a.y ()), y);
+}
+
+void CMapPolygon::clip (QPolygonF const & polygon, QRectF const & rect, QPolygonF& clipped)
+{
+  // One pass by edge, the output of a pass is the input of the next one.
+  QPolygonF input;
+  clipped = polygon;
+  for (EEdge edge : { Left, Right, Top, Bottom })
+  {
+    if (clipped.isEmpty ())
+    {
+      break;
+    }
+
+    input.swap (clipped);
+    clipped.clear ();
+    QPointF s   = input.last ();
+    bool    sIn = inside (s, rect, edge);
+    for (QPointF const & e : qAsConst (input))
+    {
+      bool eIn = inside (e, rect, edge);
+      if (eIn != sIn)
+      {
+        clipped.append (intersection (s, e, rect, edge));
+      }
+
+      if (eIn)
       {
-        QPoint pi = tileAdapter->coordinatesToWidget (vertex, vt);
-        polygon.append (QPointF (pi));
+        clipped.append (e);
       }
 
-      painter->drawPolygon (polygon.constData (), polygon.size (), Qt::OddEvenFill);
+      s   = e;
+      sIn = eIn;
     }
   }
 }
@@ -1,7 +1,7 @@
 ﻿#ifndef MAPPOLYGON_HPP
 #define MAPPOLYGON_HPP
 
-#include "mapshape.hpp"
+#include "projectedpaths.hpp"
 
 class QPainter;
 class QBrush;
@@ -39,28 +39,40 @@ public:
    *  \param id: The map shape identifier.
    */
   CMapPolygon (TPaths const & paths, CAabb const & aabb, TMapShapeId id = 0) : CMapShape (Polygon, id),
-    m_paths (paths), m_aabb (aabb) {}
+    m_paths (paths), m_aabb (aabb) { m_projection.reset (m_paths); }
 
   /*! Returns the border color */
   QRgb borderColor () const { return m_color; }
 
   /*! Sets the border color; */
-  void setBorderColor (QRgb color) { m_borderColor = color; }
+  void setBorderColor (QRgb color) { m_borderColor = color; changed (); }
 
   /*! Returns the border width in pixels */
   int borderWidth () const { return m_borderWidth; }
 
   /*! Sets the border width in pixels */
-  void setBorderWidth (int width) { m_borderWidth = width; }
+  void setBorderWidth (int width) { m_borderWidth = width; changed (); }
 
   /*! Sets the bounding box. */
-  void setAabb (CAabb const & aabb) { m_aabb = aabb; }
+  void setAabb (CAabb const & aabb) { m_aabb = aabb; changed (); }
 
   /*! Returns the number of vertexes. */
   int vertexCount () const;
 
+  /*! Clips a polygon by a rectangle (Sutherland-Hodgman algorithm).
+   *  The edges added along the rectangle are drawn, the rectangle must include the stroke margin.
+   *
+   *  \param polygon: The polygon.
+   *  \param rect: The clip rectangle.
+   *  \param clipped: The clipped polygon. Empty if the polygon is outside the rectangle.
+   */
+  static void clip (QPolygonF const & polygon, QRectF const & rect, QPolygonF& clipped);
+
   /*! See the same functions on the base class. */
   void draw (QPainter* painter, CTileAdapter* tileAdapter, SViewportToWidget const & vt) const override;
+  bool batchStyle (SStyle& style) const override;
+  void drawGeometry (QPainter* painter, QPainterPath& path, CTileAdapter* tileAdapter, SViewportToWidget const & vt) const override;
+  void prepareDraw (CTileAdapter* tileAdapter, SViewportToWidget const & vt) const override;
   bool isVisible (CAabb const & aabb) const override;
   bool contains (TGeoCoord const & coords, TCoordType, TCoordType) const override;
   CAabb aabb (TCoordType = 0, TCoordType = 0) const override;
@@ -70,6 +82,8 @@ protected:
   int    m_borderWidth = 1;
   TPaths m_paths;
   CAabb  m_aabb;
+
+  mutable CProjectedPaths m_projection; //!< m_paths projected for the last zoom drawn.
 };
 
 #endif // MAPPOLYGON_HPP
@@ -1,6 +1,7 @@
 ﻿#include "mappolyline.hpp"
 #include "tileadapter.hpp"
 #include <QPainter>
+#include <QPainterPath>
 
 CAabb CMapPolyline::aabb (TCoordType, TCoordType) const
 {
@@ -18,14 +19,65 @@ void CMapPolyline::draw (QPainter* painter, CTileAdapter* tileAdapter, SViewport
   if (CStatus::contains (Visible))
   {
     updatePen (painter, m_color, m_width);
+    QPainterPath path;
+    drawGeometry (painter, path, tileAdapter, vt);
+    if (!path.isEmpty ())
+    {
+      painter->strokePath (path, painter->pen ());
+    }
+  }
+}
+
+bool CMapPolyline::batchStyle (SStyle& style) const
+{
+  style.m_penColor   = m_color;
+  style.m_penWidth   = m_width;
+  style.m_brushColor = 0;
+  return true;
+}
+
+void CMapPolyline::prepareDraw (CTileAdapter* tileAdapter, SViewportToWidget const & vt) const
+{
+  m_projection.path (m_path, tileAdapter, vt.m_zoom);
+}
+
+void CMapPolyline::drawGeometry (QPainter* painter, QPainterPath& path, CTileAdapter* tileAdapter, SViewportToWidget const & vt) const
+{
+  QRectF           rect   = drawingRect (painter, m_width + 1);
+  QPolygon const & points = m_projection.path (m_path, tileAdapter, vt.m_zoom);
+  if (points.size () == 1)
+  { // Smaller than a pixel at this zoom.
+    QPoint dot = vt.toWidget (points.first ());
+    if (rect.contains (dot))
+    {
+      painter->drawPoint (dot);
+    }
+  }
+  else if (points.size () > 1)
+  {
     QPolygonF polygon;
-    for (TGeoCoord const & vertex : m_path)
+    polygon.reserve (points.size ());
+    for (QPoint const & point : points)
     {
-      QPoint pi = tileAdapter->coordinatesToWidget (vertex, vt);
-      polygon.append (QPointF (pi));
+      polygon.append (QPointF (vt.toWidget (point)));
     }
 
-    painter->drawPolyline (polygon);
+    // Only the visible geometry is given to QPainter.
+    QRectF bounds = polygon.boundingRect ();
+    if (rect.contains (bounds))
+    {
+      path.addPolygon (polygon);
+    }
+    else if (bounds.left () <= rect.right () && bounds.right () >= rect.left () &&
+             bounds.top () <= rect.bottom () && bounds.bottom () >= rect.top ())
+    {
+      QVector<QPolygonF> parts;
+      clip (polygon, rect, parts);
+      for (QPolygonF const & part : qAsConst (parts))
+      {
+        path.addPolygon (part);
+      }
+    }
   }
 }
 
@@ -41,9 +93,13 @@ enum EPos : quint8 { INSIDE = 0, // 0000
                      TOP    = 8, // 1000
                    };
 
-bool CMapPolyline::passThrough (TCoordType x0, TCoordType y0, TCoordType x1, TCoordType y1, TCoordType xmin, TCoordType ymin, TCoordType xmax, TCoordType ymax)
+/*! Clips the segment [(x0, y0), (x1, y1)] by a rectangle (Cohen-Sutherland algorithm).
+ *  Returns false if the segment is outside the rectangle.
+ */
+template<typename T>
+static bool clipSegment (T& x0, T& y0, T& x1, T& y1, T xmin, T ymin, T xmax, T ymax)
 {
-  auto code = [xmin, ymin, xmax, ymax] (TCoordType x, TCoordType y) -> quint8
+  auto code = [xmin, ymin, xmax, ymax] (T x, T y) -> quint8
   {
     quint8 c = INSIDE;
     if (x < xmin)
@@ -90,7 +146,7 @@ bool CMapPolyline::passThrough (TCoordType x0, TCoordType y0, TCoordType x1, TCo
     //   y = y0 + slope * (xm - x0), where xm is xmin or xmax
     // No need to worry about divide-by-zero because, in each case, the
     // c bit being tested guarantees the denominator is non-zero
-    TCoordType    x, y;
+    T      x, y;
     quint8 c = c1 > c0 ? c1 : c0;
     if ((c & TOP) != 0)
     {
@@ -130,6 +186,44 @@ bool CMapPolyline::passThrough (TCoordType x0, TCoordType y0, TCoordType x1, TCo
   return passThrough;
 }
 
+bool CMapPolyline::passThrough (TCoordType x0, TCoordType y0, TCoordType x1, TCoordType y1, TCoordType xmin, TCoordType ymin, TCoordType xmax, TCoordType ymax)
+{
+  return clipSegment (x0, y0, x1, y1, xmin, ymin, xmax, ymax);
+}
+
+void CMapPolyline::clip (QPolygonF const & polyline, QRectF const & rect, QVector<QPolygonF>& parts)
+{
+  parts.clear ();
+  QPolygonF part;
+  for (int i = 1, count = polyline.size (); i < count; ++i)
+  {
+    qreal x0 = polyline.at (i - 1).x (), y0 = polyline.at (i - 1).y ();
+    qreal x1 = polyline.at (i).x (),     y1 = polyline.at (i).y ();
+    if (clipSegment (x0, y0, x1, y1, rect.left (), rect.top (), rect.right (), rect.bottom ()))
+    {
+      // A clipped start begins a new part, else the segment continues the current part.
+      QPointF p0 (x0, y0);
+      if (part.isEmpty () || part.last () != p0)
+      {
+        if (!part.isEmpty ())
+        {
+          parts.append (part);
+        }
+
+        part = QPolygonF ();
+        part.append (p0);
+      }
+
+      part.append (QPointF (x1, y1));
+    }
+  }
+
+  if (!part.isEmpty ())
+  {
+    parts.append (part);
+  }
+}
+
 bool CMapPolyline::contains (TGeoCoord const & coords, TCoordType dx, TCoordType dy) const
 {
   dx *= std::max (m_pickingSize, m_width);
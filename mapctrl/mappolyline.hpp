@@ -1,7 +1,7 @@
 ﻿#ifndef MAPPOLYLINE_HPP
 #define MAPPOLYLINE_HPP
 
-#include "mapshape.hpp"
+#include "projectedpaths.hpp"
 
 /*! \brief The CMapPolyline class defines a geographic polyline.
  *
@@ -25,22 +25,25 @@ public:
    *
    *  \remark The bounding box is automatically computed.
    */
-  CMapPolyline (TPath const & path, TMapShapeId id = 0) : CMapShape (Polyline, id), m_path (path) {}
+  CMapPolyline (TPath const & path, TMapShapeId id = 0) : CMapShape (Polyline, id), m_path (path) { m_projection.reset (m_path); }
 
   /*! Returns the list of vertexes. */
   TPath const & path () const { return m_path; }
 
   /*! Sets the list of vertexes. */
-  void setPath (TPath const & path) { m_path = path; }
+  void setPath (TPath const & path) { m_path = path; m_projection.reset (m_path); changed (); }
 
   /*! Returns the pen width in pixels. */
   int width () const { return m_width; }
 
   /*! Sets the pen width in pixels. */
-  void setWidth (int width) { m_width = width; }
+  void setWidth (int width) { m_width = width; changed (); }
 
   /*! See the same functions on the base class. */
   void draw (QPainter* painter, CTileAdapter* tileAdapter, SViewportToWidget const & vt) const override;
+  bool batchStyle (SStyle& style) const override;
+  void drawGeometry (QPainter* painter, QPainterPath& path, CTileAdapter* tileAdapter, SViewportToWidget const & vt) const override;
+  void prepareDraw (CTileAdapter* tileAdapter, SViewportToWidget const & vt) const override;
   bool isVisible (CAabb const &) const override;
   bool contains (TGeoCoord const & coords, TCoordType dx, TCoordType dy) const override;
   CAabb aabb (TCoordType = 0, TCoordType = 0) const override;
@@ -52,9 +55,18 @@ public:
    */
   static bool passThrough (TCoordType x0, TCoordType y0, TCoordType x1, TCoordType y1, TCoordType xmin, TCoordType ymin, TCoordType xmax, TCoordType ymax);
 
+  /*! Clips a polyline by a rectangle (Cohen-Sutherland algorithm as passThrough).
+   *  \param polyline: The polyline.
+   *  \param rect: The clip rectangle.
+   *  \param parts: The parts of the polyline in the rectangle.
+   */
+  static void clip (QPolygonF const & polyline, QRectF const & rect, QVector<QPolygonF>& parts);
+
 protected:
   TPath m_path;
   int   m_width = 1;
+
+  mutable CProjectedPaths m_projection; //!< m_path projected for the last zoom drawn.
 };
 
 #endif // MAPPOLYLINE_HPP
@@ -1,7 +1,9 @@
 ﻿#include "mapshape.hpp"
 #include <QPainter>
 
-int CMapShape::m_pickingSize = 3; // 3 pixels on either side of the search point
+int     CMapShape::m_pickingSize = 3; // 3 pixels on either side of the search point
+quint32 CMapShape::m_changeCount = 0;
+bool    CMapShape::m_integerStorage = false;
 
 void CMapShape::updatePen (QPainter* painter, quint32 color, int width) const
 {
@@ -32,6 +34,23 @@ void CMapShape::updatePen (QPainter* painter, quint32 color, int width) const
   }
 }
 
+QRectF CMapShape::drawingRect (QPainter const * painter, qreal margin)
+{
+  QRectF rect;
+  if (painter->hasClipping ())
+  {
+    rect = painter->clipBoundingRect ();
+  }
+  else
+  {
+    QPaintDevice const * device = painter->device ();
+    rect                        = QRectF (0, 0, device->width () / device->devicePixelRatioF (),
+                                          device->height () / device->devicePixelRatioF ());
+  }
+
+  return rect.adjusted (-margin, -margin, margin, margin);
+}
+
 void CMapShape::updateBrush (QPainter* painter, quint32 color) const
 {
   QBrush brush = painter->brush ();
@@ -6,9 +6,11 @@
 #include <QRect>
 #include <QRgb>
 #include <QVector>
+#include <QHash>
 
 class QPen;
 class QPainter;
+class QPainterPath;
 class CTileAdapter;
 class CAabb;
 class QBrush;
@@ -49,12 +51,31 @@ public:
       m_ry   = static_cast<TCoordType>(tileRect.height ()) / viewport.height ();
     }
 
+    /*! Returns the widget coordinates of a point on tile (see CTileAdapter::coordinatesToViewport). */
+    QPoint toWidget (QPoint const & point) const
+    {
+      return QPoint (::qRound ((point.x () - m_vx0) * m_rx + m_tx0), ::qRound ((point.y () - m_vy0) * m_ry + m_ty0));
+    }
+
     int        m_zoom;       // Current zoom factor.
     int        m_vx0, m_vy0; // Viewport origin.
     int        m_tx0, m_ty0; // tile origin of viewport in pixel.
     TCoordType m_rx,  m_ry;  // Length ratios.
   };
 
+  /*! Pen and brush of a shape drawn in a batch (see batchStyle). */
+  struct SStyle
+  {
+    QRgb m_penColor   = 0;  //!< Pen color (argb).
+    int  m_penWidth   = -1; //!< Pen width in pixels. -1 means Qt::NoPen.
+    QRgb m_brushColor = 0;  //!< Brush color (argb). 0 means Qt::NoBrush.
+
+    bool operator == (SStyle const & other) const
+    {
+      return m_penColor == other.m_penColor && m_penWidth == other.m_penWidth && m_brushColor == other.m_brushColor;
+    }
+  };
+
   /*! Status of map shapde. */
   enum EStatus : quint32 { Visible = 0x00000001, // Visible or not/
                          };
@@ -97,7 +118,7 @@ public:
   inline TCoordType z () const { return m_z; }
 
   /*! Sets z. */
-  inline void setZ (TCoordType z) { m_z = z; }
+  inline void setZ (TCoordType z) { m_z = z; changed (); }
 
   /*! Returns the map shape color. */
   inline QRgb color () const;
@@ -118,6 +139,15 @@ public:
    */
   void updateBrush (QPainter* painter, quint32 color) const;
 
+  /*! Returns the rectangle drawn by the QPainter in widget coordinates.
+   *  It is the clip rectangle, or the paint device without clipping, enlarged by a margin.
+   *  The shapes use it to clip their geometry before the rasterization.
+   *
+   *  \param painter: The current QPainter.
+   *  \param margin: Margin in pixels, generally the pen width, to hide the clipped strokes.
+   */
+  static QRectF drawingRect (QPainter const * painter, qreal margin);
+
   /*! Returns true if the map shape is visible.
    *  The map shape is visible if the flag Visible is set and if all coordinates aare in the bounding box.
    *
@@ -131,6 +161,30 @@ public:
    */
   virtual void draw (QPainter*, CTileAdapter*, SViewportToWidget const &) const = 0;
 
+  /*! Returns true if the shape can be drawn in a batch with the shapes of the same style.
+   *  The map widget sets the pen and the brush of the style once, calls drawGeometry for each
+   *  shape of the batch and draws the whole batch with one QPainter::drawPath. The path uses
+   *  Qt::WindingFill, so the overlaps of translucent shapes of a batch are blended once.
+   *  By default, the shapes are not drawn in batch.
+   *
+   *  \param style: The pen and the brush used by the shape.
+   */
+  virtual bool batchStyle (SStyle& /*style*/) const { return false; }
+
+  /*! Appends the geometry of the map shape at path, drawn by the caller with the pen and the brush of the style.
+   *  The geometry which can not be in a path (e.g. dots) is drawn directly with the QPainter.
+   *  Called only for the shapes returning true from batchStyle.
+   */
+  virtual void drawGeometry (QPainter*, QPainterPath&, CTileAdapter*, SViewportToWidget const &) const {}
+
+  /*! Computes the caches used by draw for the current zoom.
+   *  Called from the GUI thread before each draw, so draw only reads the caches and can run in other threads.
+   */
+  virtual void prepareDraw (CTileAdapter*, SViewportToWidget const &) const {}
+
+  /*! Returns true if draw can be called from another thread than the GUI thread. By default true. */
+  virtual bool drawableInThread () const { return true; }
+
   /*! Returns true if the map shape is near of a point.
    *  \param TGeoCoord: the test point.
    *  \param TCoordType: The latitude angle corresponding at 1 pixel.
@@ -147,13 +201,33 @@ public:
   /*! Sets the picking square in pixel. */
   static void setPickingSize (int size) { m_pickingSize = size; }
 
+  /*! Returns true if the polygons and polylines store their vertexes in integer world coordinates. */
+  static bool integerStorage () { return m_integerStorage; }
+
+  /*! Sets the integer storage of the polygons and polylines created or modified after this call.
+   *  The vertexes are converted once in 32 bits Web Mercator coordinates (see CProjectedPaths).
+   *  The projection at a new zoom needs no more trigonometry, at the cost of 8 bytes by vertex.
+   *  Disabled by default.
+   */
+  static void setIntegerStorage (bool enable) { m_integerStorage = enable; }
+
+  /*! Returns a counter incremented by each change of a shape appearance.
+   *  The map widget redraws the shapes only when this counter has changed.
+   */
+  static quint32 changeCount () { return m_changeCount; }
+
 protected:
+  /*! Must be called by the setters modifying the shape appearance. */
+  static void changed () { ++m_changeCount; }
+
   EType       m_type  = NoType;      //!< Map shape type.
   QRgb        m_color = 0xFF000000;  //!< Map shape color (black).
   TMapShapeId m_id;                  //!< Map shape identifer. 0 by default.
   TCoordType  m_z = 0;               //!< Defines the order of draw.
 
-  static int  m_pickingSize;         //!< Square picking size. Default 3 pixels.
+  static int     m_pickingSize;      //!< Square picking size. Default 3 pixels.
+  static quint32 m_changeCount;      //!< Number of shape changes.
+  static bool    m_integerStorage;   //!< Polygons and polylines store world coordinates.
 };
 
 bool CMapShape::isVisible () const
@@ -163,7 +237,8 @@ bool CMapShape::isVisible () const
 
 void CMapShape::setVisible (bool visible)
 {
-  visible ? add (Visible) : remove (visible);
+  visible ? add (Visible) : remove (Visible);
+  changed ();
 }
 
 TMapShapeId CMapShape::id () const
@@ -194,6 +269,12 @@ QRgb CMapShape::color () const
 void CMapShape::setColor (QRgb color)
 {
   m_color = color;
+  changed ();
+}
+
+inline uint qHash (CMapShape::SStyle const & style, uint seed = 0)
+{
+  return ::qHash (style.m_penColor, seed) ^ ::qHash (style.m_penWidth, seed) ^ (::qHash (style.m_brushColor, seed) * 31);
 }
 
 #endif // MAPSHAPE_HPP
@@ -1,6 +1,7 @@
 ﻿#include "maptext.hpp"
 #include "tileadapter.hpp"
 #include <QPainter>
+#include <QFontDatabase>
 
 CAabb CMapText::aabb (TCoordType dx, TCoordType dy) const
 {
@@ -34,47 +35,67 @@ CAabb CMapText::aabb (TCoordType dx, TCoordType dy) const
   return aabb;
 }
 
-void CMapText::draw (QPainter* painter, CTileAdapter* tileAdapter, SViewportToWidget const & vt) const
+bool CMapText::updateFont (QFont& font) const
 {
-  if (CStatus::contains (Visible))
+  bool updateFont = false;
+  if (!m_family.isEmpty () && font.family () != m_family)
   {
-    updatePen (painter, m_color, 1);
-    QFont font       = painter->font ();
-    bool  updateFont = false;
-    if (!m_family.isEmpty () && font.family () != m_family)
-    {
-      font.setFamily (family ());
-      updateFont = true;
-    }
+    font.setFamily (family ());
+    updateFont = true;
+  }
 
-    if (m_pointSize != -1 && font.pixelSize () != m_pointSize)
-    {
-      font.setPointSize (m_pointSize);
-      updateFont = true;
-    }
+  if (m_pointSize != -1 && font.pixelSize () != m_pointSize)
+  {
+    font.setPointSize (m_pointSize);
+    updateFont = true;
+  }
 
-    if (m_weight != -1 && font.weight () != m_weight)
-    {
-      font.setWeight (m_weight);
-      updateFont = true;
-    }
+  if (m_weight != -1 && font.weight () != m_weight)
+  {
+    font.setWeight (m_weight);
+    updateFont = true;
+  }
 
-    if (font.italic () != m_italic)
-    {
-      font.setItalic (m_italic);
-      updateFont = true;
-    }
+  if (font.italic () != m_italic)
+  {
+    font.setItalic (m_italic);
+    updateFont = true;
+  }
+
+  return updateFont;
+}
+
+void CMapText::prepareDraw (CTileAdapter*, SViewportToWidget const &) const
+{
+  if (!m_size.isValid ())
+  {
+    QFont font;
+    updateFont (font);
+    m_size = QFontMetrics (font).boundingRect (m_text).size ();
+  }
+}
 
-    if (updateFont)
+bool CMapText::drawableInThread () const
+{
+  return QFontDatabase::supportsThreadedFontRendering ();
+}
+
+void CMapText::draw (QPainter* painter, CTileAdapter* tileAdapter, SViewportToWidget const & vt) const
+{
+  if (CStatus::contains (Visible))
+  {
+    updatePen (painter, m_color, 1);
+    QFont font = painter->font ();
+    if (updateFont (font))
     {
       painter->setFont (font);
     }
 
-    QPoint       loc = tileAdapter->coordinatesToWidget (m_coordinates, vt);
-    int          x   = loc.x ();
-    int          y   = loc.y ();
+    QPoint       loc  = tileAdapter->coordinatesToWidget (m_coordinates, vt);
+    int          x    = loc.x ();
+    int          y    = loc.y ();
     QFontMetrics fm (painter->font ());
-    m_size = fm.boundingRect (m_text).size ();
+    QSize        size = fm.boundingRect (m_text).size ();
 
     painter->setBackgroundMode ((m_backgroundColor & 0xFF000000) != 0 ? Qt::OpaqueMode : Qt::TransparentMode);
     painter->setBackground (QColor (m_backgroundColor));
@@ -86,25 +107,25 @@ void CMapText::draw (QPainter* painter, CTileAdapter* tileAdapter, SViewportToWi
     {
       if ((m_flags & Qt::AlignRight) != 0)
       {
-        x -= m_size.width ();
+        x -= size.width ();
       }
       else if ((m_flags & Qt::AlignHCenter) != 0)
       {
-        x -= m_size.width () / 2;
+        x -= size.width () / 2;
       }
 
       if ((m_flags & Qt::AlignTop) != 0)
       {
-        y -= m_size.height ();
+        y -= size.height ();
       }
       else if ((m_flags & Qt::AlignVCenter) != 0)
       {
-        y -= m_size.height () / 2;
+        y -= size.height () / 2;
       }
 
       x += m_anchorPoint.x ();
       y += m_anchorPoint.y ();
-      QRect rc (x - 1, y - 1, m_size.width () + 2, m_size.height () + 2);
+      QRect rc (x - 1, y - 1, size.width () + 2, size.height () + 2);
       painter->drawText (rc, m_flags, m_text);
     }
   }
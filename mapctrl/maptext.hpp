@@ -3,6 +3,8 @@
 
 #include "mapanchoredlocation.hpp"
 
+class QFont;
+
 /*! \brief The text is defined in terms of a TGeoCoord which specifies the location of the text.
  *
  *  The parameters are (see also QFont):
@@ -72,25 +74,25 @@ public:
   QRgb backgroundColor () const { return m_backgroundColor; }
 
   /*! Returns the text content. */
-  void setText (QString const & text) { m_text = text; }
+  void setText (QString const & text) { m_text = text; m_size = QSize (); changed (); }
 
   /*! Sets the font family. */
-  void setFamily (QString const & family) { m_family = family; }
+  void setFamily (QString const & family) { m_family = family; m_size = QSize (); changed (); }
 
   /*! Sets the font point size. */
-  void setPointSize (int pointSize) { m_pointSize = pointSize; }
+  void setPointSize (int pointSize) { m_pointSize = pointSize; m_size = QSize (); changed (); }
 
   /*! Sets the font weight. */
-  void setWeight (int weight) { m_weight = weight; }
+  void setWeight (int weight) { m_weight = weight; m_size = QSize (); changed (); }
 
   /*! Sets the italic flag. */
-  void setItalic (int italic) { m_italic = italic; }
+  void setItalic (int italic) { m_italic = italic; m_size = QSize (); changed (); }
 
   /*! Sets the position flags. */
-  void setFlags (int flags) { m_flags = flags; }
+  void setFlags (int flags) { m_flags = flags; changed (); }
 
   /*! Returns the background color. */
-  void setBackgroundColor (QRgb backgroundColor) { m_backgroundColor = backgroundColor; }
+  void setBackgroundColor (QRgb backgroundColor) { m_backgroundColor = backgroundColor; changed (); }
 
   /*! See the base class. */
   void draw (QPainter* painter, CTileAdapter* tileAdapter, SViewportToWidget const & vt) const override;
@@ -98,8 +100,19 @@ public:
   bool contains (TGeoCoord const & coords, TCoordType dx = 0, TCoordType dy = 0) const override;
   CAabb aabb (TCoordType dx, TCoordType dy) const override;
 
+  /*! Measures the text with its font over the default font, once until the text or the font changes.
+   *  The size is used by aabb and contains.
+   */
+  void prepareDraw (CTileAdapter* tileAdapter, SViewportToWidget const & vt) const override;
+
+  /*! Returns true if the platform supports the text rendering outside the GUI thread. */
+  bool drawableInThread () const override;
+
 protected:
-  mutable QSize m_size;
+  /*! Applies the family, the size, the weight and the italic flag. Returns true if font has changed. */
+  bool updateFont (QFont& font) const;
+
+  mutable QSize m_size; //!< Size of the text. Invalid until measured by prepareDraw.
   QString       m_text;
   QString       m_family;
   int           m_flags           = 0;
@@ -9,14 +9,28 @@
 #include "mapcircle.hpp"
 #include "maptext.hpp"
 #include <QPainter>
+#include <QPainterPath>
 #include <QMouseEvent>
 #include <QShortcut>
+#include <algorithm>
+#include <cstring>
+#include <limits>
 #ifndef Q_OS_WASM
 #include <QToolTip>
 #endif
 
+// Minimum height of the bands drawn in parallel, in pixels.
+static int const MinBandHeight = 64;
+
 CMapWidget::CMapWidget (QWidget* parent) : QFrame (parent)
 {
+  m_tileTimer.setSingleShot (true);
+  m_tileTimer.setInterval (30);
+  connect (&m_tileTimer, &QTimer::timeout, this, [this] ()
+  { // The new tiles can be anywhere in the frame. A pan does not clear this.
+    remove (TileLayer);
+    update ();
+  });
 }
 
 CMapWidget::~CMapWidget ()
@@ -37,7 +51,16 @@ void CMapWidget::setTiteAdapter (CTileAdapter* adapter)
 {
   delete m_tileAdapter;
   m_tileAdapter = adapter;
-  connect (m_tileAdapter, &CTileAdapter::newTileAvailable, this, QOverload<>::of(&CMapWidget::update));
+  remove (TileLayer);
+  remove (ShapeLayer);
+  connect (m_tileAdapter, &CTileAdapter::newTileAvailable, this, [this] ()
+  {
+    // One repaint for all tiles decoded during the interval.
+    if (!m_tileTimer.isActive ())
+    {
+      m_tileTimer.start ();
+    }
+  });
 }
 
 void CMapWidget::setCenter (TGeoCoord center)
@@ -61,23 +84,109 @@ void CMapWidget::setZoom (int zoom)
 QPixmap CMapWidget::tile (int i, int j) const
 {
   QPixmap pixmap;
-  QString id = m_tileAdapter->url (i, j, m_zoom);
-  if (!m_tileAdapter->contains (id))
+  if (!m_tileAdapter->contains (i, j, m_zoom))
   {
     m_tileAdapter->tile (i, j, m_zoom);
   }
   else
   {
-#ifdef Q_OS_WASM
-    pixmap = m_tileAdapter->value (id);
-#else
     pixmap = m_tileAdapter->fromCache (i, j, m_zoom);
-#endif
+    if (pixmap.isNull ())
+    { // A tile queued by the prefetch is now visible.
+      m_tileAdapter->promote (i, j, m_zoom);
+    }
   }
 
   return pixmap;
 }
 
+void CMapWidget::drawTile (QPainter& painter, int i, int j, int x, int y) const
+{
+  int     tileSize = m_tileAdapter->tileSize ();
+  QPixmap pixmap   = tile (i, j);
+  if (pixmap.size () / pixmap.devicePixelRatio () == QSize (tileSize, tileSize))
+  {
+    painter.drawPixmap (x, y, pixmap);
+  }
+  else
+  { // While the tile is loading, the nearest ancestor in memory is scaled up.
+    QRect source;
+    pixmap = m_tileAdapter->ancestorFromCache (i, j, m_zoom, source);
+    if (!pixmap.isNull ())
+    {
+      painter.setRenderHint (QPainter::SmoothPixmapTransform);
+      painter.drawPixmap (QRect (x, y, tileSize, tileSize), pixmap, source);
+      painter.setRenderHint (QPainter::SmoothPixmapTransform, false);
+    }
+  }
+}
+
+TTileRects CMapWidget::tileRects () const
+{
+  TTileRects rects;
+  rects.reserve (4);
+
+  // Visible tiles.
+  int i0 = m_cv.m_tileI - m_cv.m_tilesLeft;
+  int i1 = m_cv.m_tileI + m_cv.m_tilesRight;
+  int j0 = m_cv.m_tileJ - m_cv.m_tilesAbove;
+  int j1 = m_cv.m_tileJ + m_cv.m_tilesBottom;
+
+  // Visible tiles and rings around them.
+  int ring = std::max (0, m_prefetchPolicy.m_ring);
+  rects.append (STileRect (m_zoom, QRect (QPoint (i0 - ring, j0 - ring), QPoint (i1 + ring, j1 + ring))));
+
+  // Tiles along the pan velocity vector.
+  int lookAhead = m_prefetchPolicy.m_panLookAhead;
+  if (lookAhead > 0 && contains (Pan))
+  {
+    int        tileSize = m_tileAdapter->tileSize ();
+    TCoordType horizon  = m_prefetchPolicy.m_panHorizon;
+    int        di       = qBound (-lookAhead, ::qRound (m_panVelocity.x () * horizon / tileSize), lookAhead);
+    int        dj       = qBound (-lookAhead, ::qRound (m_panVelocity.y () * horizon / tileSize), lookAhead);
+    if (di != 0 || dj != 0)
+    {
+      rects.append (STileRect (m_zoom, QRect (QPoint (i0 + di, j0 + dj), QPoint (i1 + di, j1 + dj))));
+    }
+  }
+
+  // Parent tiles at zoom - 1.
+  if (m_prefetchPolicy.m_parentZoom)
+  {
+    rects.append (STileRect (m_zoom - 1, QRect (QPoint (i0 >> 1, j0 >> 1), QPoint (i1 >> 1, j1 >> 1))));
+  }
+
+  // Tiles at zoom + 1 visible after a zoom in (the center half of the widget).
+  if (m_prefetchPolicy.m_childZoom)
+  {
+    int tileSize = m_tileAdapter->tileSize ();
+    int cx       = m_centerOnTiles.x () << 1;
+    int cy       = m_centerOnTiles.y () << 1;
+    int w        = width ()  >> 1;
+    int h        = height () >> 1;
+    rects.append (STileRect (m_zoom + 1, QRect (QPoint ((cx - w) / tileSize, (cy - h) / tileSize),
+                                                QPoint ((cx + w) / tileSize, (cy + h) / tileSize))));
+  }
+
+  return rects;
+}
+
+void CMapWidget::prefetch ()
+{
+  // The first rectangle contains the visible tiles, already requested by paintEvent.
+  TTileRects rects = tileRects ();
+  for (STileRect const & rect : qAsConst (rects))
+  {
+    for (int i = rect.m_rect.left (); i <= rect.m_rect.right (); ++i)
+    {
+      for (int j = rect.m_rect.top (); j <= rect.m_rect.bottom (); ++j)
+      {
+        m_tileAdapter->prefetch (i, j, rect.m_z);
+      }
+    }
+  }
+}
+
 void CMapWidget::initTransformations ()
 {
   add (InitTransformations);
@@ -146,6 +255,21 @@ void CMapWidget::initTransformations ()
   // For small zoom value [0-4], m_pixelAngleY and m_pixelAngleX are very imprecise due to Mercator projection.
   m_pixelAngleY = std::fabs (lath - lat0) / (2 * h);
   m_pixelAngleX = ::rdToDg (std::asin (std::sin (::dgToRd (m_pixelAngleY)) / std::cos (::dgToRd ((lath + lat0) / 2))));
+
+  // The requests are updated by the next paint, not for the intermediate views (see fitInView).
+  remove (TileRequests);
+}
+
+void CMapWidget::updateTileRequests ()
+{
+  // The tiles which are neither visible nor prefetched are no longer needed.
+  m_tileAdapter->abortRequests (tileRects ());
+
+  // The queued requests nearest the center are sent first.
+  int tileSize = m_tileAdapter->tileSize ();
+  m_tileAdapter->scheduler ().setCenter (m_zoom, QPointF (m_centerOnTiles) / tileSize);
+  m_tileAdapter->tileCache ().setZoom (m_zoom);
+  add (TileRequests);
 }
 
 void CMapWidget::resizeEvent (QResizeEvent*)
@@ -243,71 +367,369 @@ void CMapWidget::drawScale (QPainter& painter)
   }
 }
 
-void CMapWidget::paintEvent (QPaintEvent*)
+void CMapWidget::drawTiles (QPainter& painter, QRect const & rect)
 {
-  if (!contains (InitTransformations))
+  painter.setClipRect (rect);
+  painter.fillRect (rect, palette ().window ());
+
+  // Tiles crossing the rectangle.
+  int tileSize = m_tileAdapter->tileSize ();
+  int z        = (1 << m_zoom) - 1;
+  for (int i = m_cv.m_tileI - m_cv.m_tilesLeft; i <= m_cv.m_tilesRight + m_cv.m_tileI; ++i)
   {
-    initTransformations ();
+    int x = m_cv.m_x + (i - m_cv.m_tileI) * tileSize;
+    if (i >= 0 && i <= z && x < rect.right () + 1 && x + tileSize > rect.left ())
+    {
+      for (int  j = m_cv.m_tileJ - m_cv.m_tilesAbove; j <= m_cv.m_tilesBottom + m_cv.m_tileJ; ++j)
+      {
+        int y = m_cv.m_y + (j - m_cv.m_tileJ) * tileSize;
+        if (j >= 0 && j <= z && y < rect.bottom () + 1 && y + tileSize > rect.top ())
+        {
+          drawTile (painter, i, j, x, y);
+        }
+      }
+    }
   }
+}
 
-  // Bounding box.
-  TGeoCoord v0 = m_tileAdapter->viewportToCoordinates (m_cv.m_from, m_zoom);
-  TGeoCoord v1 = m_tileAdapter->viewportToCoordinates (m_cv.m_to,   m_zoom);
-  CAabb     aabb (v0, v1);
+void CMapWidget::drawShapes (QPainter& painter, QRect const & rect)
+{
+  // The layer is transparent where there is no shape.
+  painter.setClipRect (rect);
+  painter.setCompositionMode (QPainter::CompositionMode_Source);
+  painter.fillRect (rect, Qt::transparent);
+  painter.setCompositionMode (QPainter::CompositionMode_SourceOver);
+
+  // Visible shapes, sorted by z.
+  CAabb               aabb = shapeAabb (rect);
+  QVector<CMapShape*> shapes;
+  for (CMapShape* shape : qAsConst (m_shapes))
+  {
+    if (shape->isVisible (aabb))
+    {
+      shape->prepareDraw (m_tileAdapter, m_vw);
+      shapes.append (shape);
+    }
+  }
 
-  QPainter painter (this);
-  painter.setRenderHints (QPainter::Antialiasing);
+  drawShapeList (painter, shapes);
+}
 
-  // Pixmap of first tile.
-  int     tileSize = m_tileAdapter->tileSize ();
-  QSize   pixmapSize (tileSize, tileSize);
-  QPixmap pixmap     = tile (m_cv.m_tileI, m_cv.m_tileJ);
-  int     x          = m_cv.m_x;
-  int     y          = m_cv.m_y;
-  if (pixmap.size () == pixmapSize)
+CAabb CMapWidget::shapeAabb (QRect const & rect) const
+{
+  // The margin keeps the shapes drawn around their location (texts, images...).
+  int       tileSize = m_tileAdapter->tileSize ();
+  QRect     bounds   = rect.adjusted (-tileSize, -tileSize, tileSize, tileSize);
+  TGeoCoord v0       = widgetToCoordinates (bounds.topLeft ());
+  TGeoCoord v1       = widgetToCoordinates (bounds.bottomRight ());
+  return CAabb (v0, v1);
+}
+
+void CMapWidget::drawShapeList (QPainter& painter, QVector<CMapShape*> const & shapes) const
+{
+  // Initialize pen and brush.
+  painter.setBrush (QBrush (QColor::fromRgba (0x60000000)));
+  painter.setPen (QPen (QColor::fromRgba (0x000000)));
+
+  // The shapes of the same z are grouped by style, the pen and the brush are set once by group.
+  // The shapes without batch style are drawn after the groups, in their order.
+  int const                       NoStyle = std::numeric_limits<int>::max ();
+  QHash<CMapShape::SStyle, int>   styleIndexes;
+  QVector<CMapShape::SStyle>      styles;
+  QVector<QPair<int, CMapShape*>> run;
+  for (int first = 0, count = shapes.size (); first < count;)
   {
-    painter.drawPixmap (x, y, pixmap);
+    int last = first + 1;
+    while (last < count && shapes.at (last)->z () == shapes.at (first)->z ())
+    {
+      ++last;
+    }
+
+    run.clear ();
+    for (int i = first; i < last; ++i)
+    {
+      CMapShape::SStyle style;
+      int               index = NoStyle;
+      if (shapes.at (i)->batchStyle (style))
+      {
+        index = styleIndexes.value (style, -1);
+        if (index == -1)
+        {
+          index = styles.size ();
+          styleIndexes.insert (style, index);
+          styles.append (style);
+        }
+      }
+
+      run.append (qMakePair (index, shapes.at (i)));
+    }
+
+    std::stable_sort (run.begin (), run.end (),
+                      [] (QPair<int, CMapShape*> const & a, QPair<int, CMapShape*> const & b) -> bool { return a.first < b.first; });
+
+    // The geometries of a group are drawn by one drawPath when the style changes.
+    int          current = -1;
+    QPainterPath path;
+    path.setFillRule (Qt::WindingFill);
+    for (QPair<int, CMapShape*> const & item : qAsConst (run))
+    {
+      if (item.first != current && !path.isEmpty ())
+      {
+        painter.drawPath (path);
+        path = QPainterPath ();
+        path.setFillRule (Qt::WindingFill);
+      }
+
+      if (item.first == NoStyle)
+      {
+        item.second->draw (&painter, m_tileAdapter, m_vw);
+      }
+      else
+      {
+        if (item.first != current)
+        {
+          CMapShape::SStyle const & style = styles.at (item.first);
+          painter.setPen (style.m_penWidth > 0 ? QPen (QBrush (QColor::fromRgba (style.m_penColor)), style.m_penWidth) :
+                                                 QPen (Qt::NoPen));
+          painter.setBrush (style.m_brushColor != 0 ? QBrush (QColor::fromRgba (style.m_brushColor)) : QBrush (Qt::NoBrush));
+        }
+
+        item.second->drawGeometry (&painter, path, m_tileAdapter, m_vw);
+      }
+
+      current = item.first;
+    }
+
+    if (!path.isEmpty ())
+    {
+      painter.drawPath (path);
+    }
+
+    first = last;
   }
+}
 
-  int z = (1 << m_zoom) - 1;
-  for (int i = m_cv.m_tileI - m_cv.m_tilesLeft; i <= m_cv.m_tilesRight + m_cv.m_tileI; ++i)
+void CMapWidget::drawShapesInBands (QPainter& painter, QRect const & rect)
+{
+#if QT_CONFIG(thread)
+  // Visible shapes, their bounding boxes and their projections are computed here, the bands only read them.
+  CAabb               aabb       = shapeAabb (rect);
+  bool                threadSafe = true;
+  QVector<CMapShape*> shapes;
+  QVector<CAabb>      aabbs;
+  for (CMapShape* shape : qAsConst (m_shapes))
   {
-    if (i >= 0 && i <= z)
+    if (shape->isVisible (aabb))
     {
-      x = m_cv.m_x + (i - m_cv.m_tileI) * tileSize;
-      for (int  j = m_cv.m_tileJ - m_cv.m_tilesAbove; j <= m_cv.m_tilesBottom + m_cv.m_tileJ; ++j)
+      shape->prepareDraw (m_tileAdapter, m_vw);
+      shapes.append (shape);
+      aabbs.append (shape->aabb (m_pixelAngleX, m_pixelAngleY));
+      threadSafe = threadSafe && shape->drawableInThread ();
+    }
+  }
+
+  int bandCount = std::min (m_shapePool.maxThreadCount (), rect.height () / MinBandHeight);
+  if (threadSafe && bandCount > 1)
+  {
+    qreal           ratio = devicePixelRatioF ();
+    QVector<QRect>  bandRects (bandCount);
+    QVector<QImage> bands (bandCount);
+    for (int i = 0; i < bandCount; ++i)
+    {
+      int top      = rect.top () + rect.height () * i / bandCount;
+      int bottom   = rect.top () + rect.height () * (i + 1) / bandCount;
+      bandRects[i] = QRect (rect.left (), top, rect.width (), bottom - top);
+      m_shapePool.start ([this, i, ratio, &bandRects, &bands, &shapes, &aabbs] ()
       {
-        if (j >= 0 && j <= z && (i != m_cv.m_tileI || j != m_cv.m_tileJ))
+        // The band keeps only the shapes crossing it and is drawn in widget coordinates.
+        QRect const &       band     = bandRects.at (i);
+        CAabb               bandAabb = shapeAabb (band);
+        QVector<CMapShape*> bandShapes;
+        for (int k = 0, count = shapes.size (); k < count; ++k)
         {
-          pixmap = tile (i, j);
-          if (pixmap.size () == pixmapSize)
+          if (aabbs.at (k).intersects (bandAabb))
           {
-            y = m_cv.m_y + (j - m_cv.m_tileJ) * tileSize;
-            painter.drawPixmap (x, y, pixmap);
+            bandShapes.append (shapes.at (k));
           }
         }
+
+        QImage image (band.size () * ratio, QImage::Format_ARGB32_Premultiplied);
+        image.setDevicePixelRatio (ratio);
+        image.fill (Qt::transparent);
+        QPainter bandPainter (&image);
+        bandPainter.setRenderHints (QPainter::Antialiasing);
+        bandPainter.translate (-band.topLeft ());
+        bandPainter.setClipRect (band);
+        drawShapeList (bandPainter, bandShapes);
+        bands[i] = image;
+      });
+    }
+
+    m_shapePool.waitForDone ();
+
+    // The bands replace the rectangle of the layer.
+    painter.save ();
+    painter.setClipRect (rect);
+    painter.setCompositionMode (QPainter::CompositionMode_Source);
+    for (int i = 0; i < bandCount; ++i)
+    {
+      painter.drawImage (bandRects.at (i).topLeft (), bands.at (i));
+    }
+
+    painter.restore ();
+    return;
+  }
+#endif
+
+  drawShapes (painter, rect);
+}
+
+bool CMapWidget::scrollable (QPoint const & center, int zoom, qreal ratio) const
+{
+  // The layers are scrolled in device pixels.
+  QPoint offset = center - m_centerOnTiles;
+  return zoom == m_zoom && ratio == std::floor (ratio) && std::abs (offset.x ()) < width () && std::abs (offset.y ()) < height ();
+}
+
+/*! Moves the content of a 32 bits image by dx, dy pixels. The uncovered pixels are not modified. */
+static void scrollImage (QImage& image, int dx, int dy)
+{
+  int    width        = image.width ()  - std::abs (dx);
+  int    height       = image.height () - std::abs (dy);
+  int    bytesPerLine = image.bytesPerLine ();
+  uchar* bits         = image.bits ();
+  uchar* to           = bits + std::max (0, dy) * bytesPerLine + std::max (0, dx) * 4;
+  uchar* from         = bits + std::max (0, -dy) * bytesPerLine + std::max (0, -dx) * 4;
+  for (int k = 0; k < height; ++k)
+  { // Down, the last row first to not overwrite the rows not yet moved.
+    int row = dy > 0 ? height - 1 - k : k;
+    std::memmove (to + row * bytesPerLine, from + row * bytesPerLine, static_cast<std::size_t>(width) * 4);
+  }
+}
+
+void CMapWidget::updateTileLayer ()
+{
+  qreal ratio = devicePixelRatioF ();
+  QSize size  = QWidget::size () * ratio;
+  if (size.isEmpty ())
+  {
+    return;
+  }
+
+  QRegion exposed (rect ());
+  bool    scroll = contains (Scroll) && contains (TileLayer) && scrollable (m_tileCenter, m_tileZoom, ratio);
+  if (m_tileLayer.size () != size || m_tileLayer.devicePixelRatio () != ratio)
+  {
+    m_tileLayer = QPixmap (size);
+    m_tileLayer.setDevicePixelRatio (ratio);
+    scroll = false;
+  }
+
+  if (scroll)
+  {
+    QPoint offset = m_tileCenter - m_centerOnTiles;
+    int    scale  = static_cast<int>(ratio);
+    m_tileLayer.scroll (offset.x () * scale, offset.y () * scale, m_tileLayer.rect ());
+    exposed -= rect ().translated (offset);
+  }
+
+  m_tileCenter = m_centerOnTiles;
+  m_tileZoom   = m_zoom;
+  remove (Scroll);
+  add (TileLayer);
+
+  QPainter painter (&m_tileLayer);
+  for (QRect const & strip : exposed)
+  {
+    drawTiles (painter, strip);
+  }
+}
+
+void CMapWidget::updateShapeLayer ()
+{
+  qreal ratio = devicePixelRatioF ();
+  QSize size  = QWidget::size () * ratio;
+  if (size.isEmpty ())
+  {
+    return;
+  }
+
+  // Without change of the shapes, the layer is only moved with the center.
+  QRegion exposed (rect ());
+  bool    scroll = contains (ShapeLayer) && m_shapeChangeCount == CMapShape::changeCount () &&
+                   scrollable (m_shapeCenter, m_shapeZoom, ratio);
+  if (m_shapeLayer.size () != size || m_shapeLayer.devicePixelRatio () != ratio)
+  {
+    m_shapeLayer = QImage (size, QImage::Format_ARGB32_Premultiplied);
+    m_shapeLayer.setDevicePixelRatio (ratio);
+    scroll = false;
+  }
+
+  if (scroll)
+  {
+    QPoint offset = m_shapeCenter - m_centerOnTiles;
+    int    scale  = static_cast<int>(ratio);
+    scrollImage (m_shapeLayer, offset.x () * scale, offset.y () * scale);
+    exposed -= rect ().translated (offset);
+  }
+
+  m_shapeCenter      = m_centerOnTiles;
+  m_shapeZoom        = m_zoom;
+  m_shapeChangeCount = CMapShape::changeCount ();
+  add (ShapeLayer);
+
+  if (!exposed.isEmpty ())
+  {
+    QPainter painter (&m_shapeLayer);
+    painter.setRenderHints (QPainter::Antialiasing);
+    for (QRect const & strip : exposed)
+    {
+      if (contains (ParallelShapes))
+      {
+        drawShapesInBands (painter, strip);
+      }
+      else
+      {
+        drawShapes (painter, strip);
       }
     }
   }
+}
+
+void CMapWidget::paintEvent (QPaintEvent*)
+{
+  if (!contains (InitTransformations))
+  {
+    initTransformations ();
+  }
+
+  if (!contains (TileRequests))
+  {
+    updateTileRequests ();
+  }
 
   if (!contains (Sorted))
   {
     add (Sorted);
+    remove (ShapeLayer);
     std::sort (m_shapes.begin (), m_shapes.end (),
                [] (CMapShape const * s1, CMapShape const * s2) -> bool { return s1->z () < s2->z (); });
   }
 
-  // Initialize pen and brush.
-  painter.setBrush (QBrush (QColor::fromRgba (0x60000000)));
-  painter.setPen (QPen (QColor::fromRgba (0x000000)));
-  for (CMapShape* shape : qAsConst (m_shapes))
+  updateTileLayer ();
+
+  // The visible tiles are requested, now request the tiles probably needed soon.
+  prefetch ();
+
+  QPainter painter (this);
+  painter.drawPixmap (0, 0, m_tileLayer);
+  if (!m_shapes.isEmpty ())
   {
-    if (shape->isVisible (aabb))
-    {
-      shape->draw (&painter, m_tileAdapter, m_vw);
-    }
+    updateShapeLayer ();
+    painter.drawImage (0, 0, m_shapeLayer);
   }
 
+  painter.setRenderHints (QPainter::Antialiasing);
   if (!(contains (HideCopyrightLink)))
   {
     showCopyRightLinks (painter);
@@ -335,6 +757,8 @@ void CMapWidget::mousePressEvent (QMouseEvent* event)
     }
 
     add (MousePressed);
+    m_panVelocity = QPointF ();
+    m_panTimer.start ();
     TGeoCoord c = widgetToCoordinates (m_prePanning);
     emit mapMousePressEvent (event, c);
   }
@@ -360,9 +784,17 @@ void CMapWidget::mouseMoveEvent (QMouseEvent* event)
   { // Panning
     add (Pan);
     QPoint  offset = m_prePanning - newPosition;
+    qint64  dt     = m_panTimer.restart ();
+    if (dt > 0)
+    { // Exponential smoothing of the velocity.
+      QPointF velocity = QPointF (offset) / static_cast<qreal>(dt);
+      m_panVelocity    = m_panVelocity * 0.7 + velocity * 0.3;
+    }
+
     m_center       = m_tileAdapter->viewportToCoordinates (m_centerOnTiles + offset, m_zoom);
     m_prePanning   = newPosition;
     initTransformations ();
+    add (Scroll); // Removed by the changes needing all tiles.
     update ();
   }
   else if (contains (PickingActivated))
@@ -515,12 +947,14 @@ void CMapWidget::fitInView ()
 void CMapWidget::addMapShape (CMapShape* shape)
 {
   remove (Sorted);
+  remove (ShapeLayer);
   m_shapes.append (shape);
 }
 
 void CMapWidget::remMapShapes ()
 {
   m_shapes.clear ();
+  remove (ShapeLayer);
   update ();
 }
 
@@ -4,6 +4,11 @@
 #include "mapshape.hpp"
 #include "tileadapter.hpp"
 #include <QFrame>
+#include <QElapsedTimer>
+#include <QTimer>
+#if QT_CONFIG(thread)
+#include <QThreadPool>
+#endif
 
 class CTileAdapter;
 class CMapShape;
@@ -33,6 +38,13 @@ using TShapeList = QVector<CMapShape*>;
  * - The zoom step is limited at zoom level (e.g. [0,1,2,3,..]).
  * - Noticeably slower (Not use OpenGL to run without restriction on WebAssembly).
  * - Actually limited at OSM and ESRI.
+ *
+ * The tiles and the shapes are drawn in two layers kept between the paints. During a pan, the
+ * layers are scrolled by the pan offset and only the exposed strips are drawn. The tile layer is
+ * entirely redrawn by the other paints (new tiles, zoom...). The shape layer is entirely redrawn
+ * only when the shapes change, so a new tile costs only the composition of the shape layer.
+ * With the status ParallelShapes, the shape layer is drawn in horizontal bands by a thread pool
+ * and each band draws only the shapes crossing it.
  */
 class CMapWidget : public QFrame, public CStatus<quint32>
 {
@@ -50,22 +62,39 @@ public:
     QPoint m_from, m_to;
   };
 
+  /*! Defines the tiles requested in advance, with a lower priority than the visible tiles. */
+  struct SPrefetchPolicy
+  {
+    int  m_ring         = 1;    //!< Number of tile rings around the visible tiles. 0 to disable.
+    bool m_parentZoom   = true; //!< Prefetch the parent tiles of the visible tiles at zoom - 1.
+    bool m_childZoom    = true; //!< Prefetch the tiles at zoom + 1 visible after a zoom in.
+    int  m_panLookAhead = 2;    //!< Max number of tiles prefetched along the pan velocity. 0 to disable.
+    int  m_panHorizon   = 500;  //!< Time in ms used to extrapolate the pan velocity.
+  };
+
   enum EStatus : quint32 { PickingActivated    = 0x00000001, //!< Activate picking.
                            Sorted              = 0x00000002, //!< Activate sort by z order.
                            HideCopyrightLink   = 0x00000004, //!< Hide the copyright.
                            ShowScale           = 0x00000008, //!< Show scale.
                            USSaleUnit          = 0x00000010, //!< Set scale text with US units.
+                           ParallelShapes      = 0x00000020, //!< Draw the shapes in horizontal bands on a thread pool.
                            // Status above are transient.
                            InitTransformations = 0x00010000, //!< InitTransformations has been set.
                            Pan                 = 0x00020000, //!< Pan is in progress.
                            MousePressed        = 0x00040000, //!< The mouse as been pressed to prepare panning.
+                           Scroll              = 0x00080000, //!< Only the center has changed since the last tile layer.
+                           ShapeLayer          = 0x00100000, //!< The shape layer is up to date, except for its center.
+                           TileLayer           = 0x00200000, //!< The tile layer is up to date, except for its center.
+                           TileRequests        = 0x00400000, //!< The tile requests are up to date with the view.
                          };
 
   explicit CMapWidget (QWidget* parent = nullptr);
   ~CMapWidget () override;
 
-  /*! Returns the list of shapes as a reference. */
-  TShapeList& shapes () { return m_shapes; }
+  /*! Returns the list of shapes as a reference.
+   *  The shapes are redrawn at the next paint.
+   */
+  TShapeList& shapes () { remove (ShapeLayer); return m_shapes; }
 
   /*! Returns the list of shapes as a const reference. */
   TShapeList const & shapes () const { return m_shapes; }
@@ -93,6 +122,12 @@ public:
   /*! Removes all shapes. */
   void remMapShapes ();
 
+  /*! Redraws the shapes.
+   *  The changes made by the shape setters are detected by the next paint. This function is
+   *  needed only for the changes made otherwise (e.g. in a derived shape).
+   */
+  void updateShapes () { remove (ShapeLayer); update (); }
+
   /*! Converts the widget coordinates to geo-coordiantes. */
   TGeoCoord widgetToCoordinates (QPoint const & p) const;
 
@@ -120,6 +155,12 @@ public:
   /*! Returns the approximate latitude for one y pixel. */
   TCoordType pixelAngleY () const { return m_pixelAngleY; }
 
+  /*! Returns the tile prefetch policy. */
+  SPrefetchPolicy const & prefetchPolicy () const { return m_prefetchPolicy; }
+
+  /*! Sets the tile prefetch policy. */
+  void setPrefetchPolicy (SPrefetchPolicy const & policy) { m_prefetchPolicy = policy; }
+
   /*! Activates the keyboard shortcuts.
    *  Ctrl+ for zoom in.
    *  Ctrl- for zoom out.
@@ -190,6 +231,18 @@ protected:
 
 private:
   QPixmap tile (int i, int j) const;
+  void drawTile (QPainter& painter, int i, int j, int x, int y) const;
+  void drawTiles (QPainter& painter, QRect const & rect);
+  void drawShapes (QPainter& painter, QRect const & rect);
+  void drawShapesInBands (QPainter& painter, QRect const & rect);
+  void drawShapeList (QPainter& painter, QVector<CMapShape*> const & shapes) const;
+  CAabb shapeAabb (QRect const & rect) const;
+  bool scrollable (QPoint const & center, int zoom, qreal ratio) const;
+  void updateTileLayer ();
+  void updateTileRequests ();
+  void updateShapeLayer ();
+  TTileRects tileRects () const;
+  void prefetch ();
   void showCopyRightLinks (QPainter& painter);
   void drawScale (QPainter& painter);
 
@@ -197,6 +250,20 @@ private:
   QPoint               m_prePanning;          //!< Pointer under the cursor at button click.
   int                  m_copyrightMargin = 4; //!< Left and top margin in pixels.
   QColor               m_scaleColor      = Qt::black;
+  SPrefetchPolicy      m_prefetchPolicy;      //!< Tiles requested in advance.
+  QPointF              m_panVelocity;         //!< Smoothed pan velocity in pixels per ms.
+  QElapsedTimer        m_panTimer;            //!< Time of the last pan move.
+  QTimer               m_tileTimer;           //!< Groups the repaints of tiles arriving close together.
+  QPixmap              m_tileLayer;           //!< Tiles of the last paint.
+  QPoint               m_tileCenter;          //!< Value of m_centerOnTiles for m_tileLayer.
+  int                  m_tileZoom = -1;       //!< Zoom of m_tileLayer.
+  QImage               m_shapeLayer;          //!< Shapes of the last paint on a transparent background.
+  QPoint               m_shapeCenter;         //!< Value of m_centerOnTiles for m_shapeLayer.
+  int                  m_shapeZoom = -1;      //!< Zoom of m_shapeLayer.
+  quint32              m_shapeChangeCount = 0; //!< Value of CMapShape::changeCount for m_shapeLayer.
+#if QT_CONFIG(thread)
+  QThreadPool          m_shapePool;           //!< Draws the bands of the shape layer.
+#endif
   mutable QPoint       m_centerOnTiles;       //!< Actual center on tile space.
   mutable TCoordType   m_pixelAngleX;         //!< Longitude variation of one pixel.
   mutable TCoordType   m_pixelAngleY;         //!< Latitude variation of one pixel.
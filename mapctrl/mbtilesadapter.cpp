@@ -0,0 +1,180 @@
+﻿#include "mbtilesadapter.hpp"
+#include <QSqlError>
+#include <QSet>
+#include <QMap>
+
+CMBTilesAdapter::CMBTilesAdapter (QString const & fileName, int tileSize) :
+  CTileAdapter (QStringList (), "mbtiles", tileSize, 0, 19, false, NoDiskCache)
+{
+  m_connectionName = QStringLiteral ("mbtiles-%1").arg (reinterpret_cast<quintptr>(this), 0, 16);
+  m_database       = QSqlDatabase::addDatabase (QStringLiteral ("QSQLITE"), m_connectionName);
+  m_database.setDatabaseName (fileName);
+  m_database.setConnectOptions (QStringLiteral ("QSQLITE_OPEN_READONLY"));
+  if (m_database.open ())
+  {
+    readMetadata ();
+
+    // The tiles table is a view in some files. The columns are the same.
+    m_tileQuery = QSqlQuery (m_database);
+    m_tileQuery.setForwardOnly (true);
+    m_tileQuery.prepare (QStringLiteral ("SELECT tile_data FROM tiles "
+                                         "WHERE zoom_level = ? AND tile_column = ? AND tile_row = ?"));
+
+    m_rangeQuery = QSqlQuery (m_database);
+    m_rangeQuery.setForwardOnly (true);
+    m_rangeQuery.prepare (QStringLiteral ("SELECT tile_column, tile_row, tile_data FROM tiles "
+                                          "WHERE zoom_level = ? AND tile_column BETWEEN ? AND ? AND tile_row BETWEEN ? AND ?"));
+  }
+  else
+  {
+    m_message = m_database.lastError ().text ();
+  }
+}
+
+CMBTilesAdapter::~CMBTilesAdapter ()
+{
+  // The queries must be released before the connection is removed.
+  m_tileQuery  = QSqlQuery ();
+  m_rangeQuery = QSqlQuery ();
+  m_database.close ();
+  m_database = QSqlDatabase ();
+  QSqlDatabase::removeDatabase (m_connectionName);
+}
+
+void CMBTilesAdapter::readMetadata ()
+{
+  QSqlQuery query (m_database);
+  query.setForwardOnly (true);
+  if (query.exec (QStringLiteral ("SELECT name, value FROM metadata")))
+  {
+    while (query.next ())
+    {
+      m_metadata.insert (query.value (0).toString (), query.value (1).toString ());
+    }
+  }
+
+  QString format = m_metadata.value (QStringLiteral ("format"), QStringLiteral ("png"));
+  m_imageFormat  = format.toUpper ().toLatin1 ();
+
+  bool ok;
+  int  zoom = m_metadata.value (QStringLiteral ("minzoom")).toInt (&ok);
+  if (ok)
+  {
+    m_zoomMin = zoom;
+  }
+
+  zoom = m_metadata.value (QStringLiteral ("maxzoom")).toInt (&ok);
+  if (ok)
+  {
+    m_zoomMax = zoom;
+  }
+
+  QString name = m_metadata.value (QStringLiteral ("name"));
+  if (!name.isEmpty ())
+  {
+    m_indexNames << name;
+  }
+
+  QString attribution = m_metadata.value (QStringLiteral ("attribution"));
+  if (!attribution.isEmpty ())
+  {
+    m_copyrights << TCopyright (attribution, QString ());
+  }
+}
+
+void CMBTilesAdapter::requestTile (TTileKey key, CTileScheduler::EPriority priority)
+{
+  m_batches[priority].append (key);
+  if (!m_loadPending)
+  {
+    // All tiles of the paint are read at once.
+    m_loadPending = true;
+    QMetaObject::invokeMethod (this, "loadTiles", Qt::QueuedConnection);
+  }
+}
+
+void CMBTilesAdapter::loadTiles ()
+{
+  m_loadPending = false;
+  for (QVector<TTileKey>& batch : m_batches)
+  { // Visible tiles first.
+    QVector<TTileKey> keys;
+    keys.swap (batch);
+    readTiles (keys);
+  }
+}
+
+void CMBTilesAdapter::readTiles (QVector<TTileKey> const & keys)
+{
+  // Bounding rectangle of the requested tiles for each zoom.
+  QSet<TTileKey>   requested;
+  QMap<int, QRect> rects;
+  for (TTileKey key : keys)
+  {
+    STile const * tile = m_tiles.find (key);
+    if (tile != nullptr && tile->m_state == STile::Requested)
+    {
+      requested.insert (key);
+      QRect& rect = rects[tileKeyZ (key)];
+      rect       |= QRect (tileKeyX (key), tileKeyY (key), 1, 1);
+    }
+  }
+
+  if (isOpen ())
+  {
+    for (QMap<int, QRect>::const_iterator it = rects.cbegin (), end = rects.cend (); it != end; ++it)
+    {
+      int           z    = it.key ();
+      QRect const & rect = it.value ();
+      m_rangeQuery.bindValue (0, z);
+      m_rangeQuery.bindValue (1, rect.left ());
+      m_rangeQuery.bindValue (2, rect.right ());
+      m_rangeQuery.bindValue (3, row (rect.bottom (), z));
+      m_rangeQuery.bindValue (4, row (rect.top (), z));
+      if (m_rangeQuery.exec ())
+      {
+        while (m_rangeQuery.next ())
+        {
+          int      x   = m_rangeQuery.value (0).toInt ();
+          int      y   = row (m_rangeQuery.value (1).toInt (), z);
+          TTileKey key = tileKey (x, y, z);
+          if (requested.remove (key)) // The rectangle can contain tiles not requested.
+          {
+            tileLoaded (key, m_rangeQuery.value (2).toByteArray ());
+          }
+        }
+      }
+      else
+      {
+        m_message = m_rangeQuery.lastError ().text ();
+      }
+
+      m_rangeQuery.finish ();
+    }
+  }
+
+  for (TTileKey key : qAsConst (requested))
+  {
+    tileMissing (key);
+  }
+}
+
+QByteArray CMBTilesAdapter::cachedData (TTileKey key)
+{
+  QByteArray data;
+  if (isOpen ())
+  {
+    int z = tileKeyZ (key);
+    m_tileQuery.bindValue (0, z);
+    m_tileQuery.bindValue (1, tileKeyX (key));
+    m_tileQuery.bindValue (2, row (tileKeyY (key), z));
+    if (m_tileQuery.exec () && m_tileQuery.next ())
+    {
+      data = m_tileQuery.value (0).toByteArray ();
+    }
+
+    m_tileQuery.finish ();
+  }
+
+  return data;
+}
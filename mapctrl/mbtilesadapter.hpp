@@ -0,0 +1,65 @@
+﻿#ifndef MBTILESADAPTER_HPP
+#define MBTILESADAPTER_HPP
+
+#include "tileadapter.hpp"
+#include <QSqlDatabase>
+#include <QSqlQuery>
+
+/*! \brief The CMBTilesAdapter class used to read tiles from an MBTiles file (SQLite database).
+ *
+ *  No network request is sent and no disk cache is created. The tiles requested during
+ *  one paint are collected and read with one query per zoom level when the event loop is reached.
+ *  The tile data follows the same path as the downloaded tiles: decoder, then memory cache.
+ *  The MBTiles rows use the TMS scheme (y axis going up). The conversion is done by the adapter.
+ *  The vector tiles (format pbf, usually gzip compressed) are drawn with the vector tile style.
+ *  Tiles missing in the file are not queried again.
+ */
+class CMBTilesAdapter : public CTileAdapter
+{
+  Q_OBJECT
+public:
+  /*! Constructor.
+   *  The zoom range, the image format and the attribution are read from the metadata table.
+   *  \param fileName: The MBTiles file.
+   *  \param tileSize: The size of the tiles in pixels.
+   */
+  CMBTilesAdapter (QString const & fileName, int tileSize = 256);
+
+  /*! Destructor. Closes the database. */
+  ~CMBTilesAdapter () override;
+
+  /*! Returns true if the file is opened. On error, use errorString to get the message. */
+  bool isOpen () const { return m_database.isOpen (); }
+
+  /*! Returns the last error message. */
+  QString const & errorString () const { return m_message; }
+
+  /*! Returns the value of the metadata table for name. */
+  QString metadata (QString const & name) const { return m_metadata.value (name); }
+
+protected:
+  void requestTile (TTileKey key, CTileScheduler::EPriority priority) override;
+  QByteArray cachedData (TTileKey key) override;
+
+protected slots:
+  /*! Reads the tiles collected since the last call. */
+  void loadTiles ();
+
+private:
+  void readMetadata ();
+  void readTiles (QVector<TTileKey> const & keys);
+
+  /*! Returns the MBTiles row (TMS) from the tile y (XYZ). */
+  static int row (int y, int z) { return tileCountOnZoom (z) - 1 - y; }
+
+private:
+  QString                 m_connectionName;      //!< Name of the database connection.
+  QSqlDatabase            m_database;            //!< The MBTiles database.
+  QSqlQuery               m_tileQuery;           //!< Prepared query of one tile.
+  QSqlQuery               m_rangeQuery;          //!< Prepared query of a rectangle of tiles.
+  QHash<QString, QString> m_metadata;            //!< Content of the metadata table.
+  QVector<TTileKey>       m_batches[2];          //!< Tiles waiting to be read by priority.
+  bool                    m_loadPending = false; //!< loadTiles is queued.
+};
+
+#endif // MBTILESADAPTER_HPP
@@ -59,6 +59,9 @@ COsmTileAdapter::COsmTileAdapter (QString const & apiKey) : CTileAdapter (QStrin
                                "https://www.openstreetmap.org/copyright",
                                "https://thunderforest.com",
                              };
+  // Tile usage policies of OSM and Thunderforest: few connections and no heavy bulk download.
+  m_scheduler.setMaxConnectionsPerHost (2);
+  m_scheduler.setRateLimit (20, 20);
   setUrls (urls);
   setIndexNames (indexNames);
 
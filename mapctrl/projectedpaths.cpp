@@ -0,0 +1,220 @@
+﻿#include "projectedpaths.hpp"
+#include "tileadapter.hpp"
+#include "../tools/mercator.hpp"
+#include <cmath>
+
+QVector<QPolygon> const & CProjectedPaths::paths (TPaths const & paths, CTileAdapter const * tileAdapter, int zoom)
+{
+  bool               valid;
+  QVector<QPolygon>& level = this->level (paths.size (), tileAdapter, zoom, valid);
+  if (!valid)
+  {
+    for (int i = 0, count = paths.size (); i < count; ++i)
+    {
+      project (i, paths.at (i), tileAdapter, zoom, level[i]);
+    }
+  }
+
+  return level;
+}
+
+QPolygon const & CProjectedPaths::path (TPath const & path, CTileAdapter const * tileAdapter, int zoom)
+{
+  bool               valid;
+  QVector<QPolygon>& level = this->level (1, tileAdapter, zoom, valid);
+  if (!valid)
+  {
+    project (0, path, tileAdapter, zoom, level[0]);
+  }
+
+  return level.first ();
+}
+
+void CProjectedPaths::reset (TPaths const & paths)
+{
+  m_levels     = QVector<QVector<QPolygon>> ();
+  m_worldPaths = QVector<TWorldPath> ();
+  m_zooms      = 0;
+  m_tileSize   = 0;
+  if (CMapShape::integerStorage ())
+  {
+    m_worldPaths.reserve (paths.size ());
+    for (TPath const & path : paths)
+    {
+      m_worldPaths.append (worldPath (path));
+    }
+  }
+}
+
+void CProjectedPaths::reset (TPath const & path)
+{
+  m_levels     = QVector<QVector<QPolygon>> ();
+  m_worldPaths = QVector<TWorldPath> ();
+  m_zooms      = 0;
+  m_tileSize   = 0;
+  if (CMapShape::integerStorage ())
+  {
+    m_worldPaths.append (worldPath (path));
+  }
+}
+
+void CProjectedPaths::simplify (QPolygon& points, double tolerance)
+{
+  // Consecutive vertexes in the same pixel.
+  int count = 0;
+  for (int i = 0, size = points.size (); i < size; ++i)
+  {
+    if (count == 0 || points.at (i) != points.at (count - 1))
+    {
+      points[count++] = points.at (i);
+    }
+  }
+
+  points.resize (count);
+  if (count <= 2)
+  {
+    return;
+  }
+
+  // Douglas-Peucker without recursion. A segment [first, last] is split at its farthest vertex
+  // while this vertex is farther than the tolerance.
+  QVector<bool>            keep (count, false);
+  QVector<QPair<int, int>> segments;
+  keep[0]         = true;
+  keep[count - 1] = true;
+  segments.append (qMakePair (0, count - 1));
+  double tolerance2 = tolerance * tolerance;
+  while (!segments.isEmpty ())
+  {
+    QPair<int, int> segment  = segments.takeLast ();
+    QPoint const &  a        = points.at (segment.first);
+    double          dx       = points.at (segment.second).x () - a.x ();
+    double          dy       = points.at (segment.second).y () - a.y ();
+    double          length2  = dx * dx + dy * dy;
+    double          max      = 0;
+    int             farthest = -1;
+    for (int i = segment.first + 1; i < segment.second; ++i)
+    {
+      // Squared distance to the line times length2, or to a if the segment is a point (closed path).
+      double px = points.at (i).x () - a.x ();
+      double py = points.at (i).y () - a.y ();
+      double d  = length2 != 0 ? (px * dy - py * dx) * (px * dy - py * dx) : px * px + py * py;
+      if (d > max)
+      {
+        max      = d;
+        farthest = i;
+      }
+    }
+
+    if (farthest != -1 && max > tolerance2 * (length2 != 0 ? length2 : 1))
+    {
+      keep[farthest] = true;
+      segments.append (qMakePair (segment.first, farthest));
+      segments.append (qMakePair (farthest, segment.second));
+    }
+  }
+
+  int kept = 0;
+  for (int i = 0; i < count; ++i)
+  {
+    if (keep.at (i))
+    {
+      points[kept++] = points.at (i);
+    }
+  }
+
+  points.resize (kept);
+}
+
+CProjectedPaths::SWorldPoint CProjectedPaths::toWorld (TGeoCoord const & coordinates)
+{
+  // Computed in double whatever TCoordType, the float mantissa is smaller than 32 bits.
+  double const pi = M_PI;
+  double       x  = (static_cast<double>(coordinates.x ()) + 180) / 360;
+  double       y  = (1 - std::log (std::tan (pi / 4 + ::dgToRd (static_cast<double>(coordinates.y ())) / 2)) / pi) / 2;
+  return { toWorld (x), toWorld (y) };
+}
+
+quint32 CProjectedPaths::toWorld (double v)
+{
+  double w = std::floor (v * 4294967296.0 + 0.5);
+  return w <= 0 ? 0 : (w >= 4294967295.0 ? 0xFFFFFFFF : static_cast<quint32>(w));
+}
+
+QVector<QPolygon>& CProjectedPaths::level (int size, CTileAdapter const * tileAdapter, int zoom, bool& valid)
+{
+  Q_ASSERT (zoom >= 0 && zoom < 32);
+  if (m_tileSize != tileAdapter->tileSize ())
+  {
+    m_levels   = QVector<QVector<QPolygon>> ();
+    m_zooms    = 0;
+    m_tileSize = tileAdapter->tileSize ();
+  }
+
+  if (m_levels.size () <= zoom)
+  {
+    m_levels.resize (zoom + 1);
+  }
+
+  QVector<QPolygon>& level = m_levels[zoom];
+  valid                    = (m_zooms & (1u << zoom)) != 0 && level.size () == size;
+  if (!valid)
+  {
+    // The levels far from the new zoom are released.
+    for (int z = 0, count = m_levels.size (); z < count; ++z)
+    {
+      if ((m_zooms & (1u << z)) != 0 && qAbs (z - zoom) > MaxLevelDistance)
+      {
+        m_levels[z] = QVector<QPolygon> ();
+        m_zooms    &= ~(1u << z);
+      }
+    }
+
+    level.resize (size);
+    m_zooms |= 1u << zoom;
+  }
+
+  return level;
+}
+
+void CProjectedPaths::project (int index, TPath const & path, CTileAdapter const * tileAdapter, int zoom, QPolygon& points)
+{
+  points.resize (path.size ());
+  int tileSize = tileAdapter->tileSize ();
+  if (index < m_worldPaths.size () && m_worldPaths.at (index).size () == path.size () && hasWorldPrecision (zoom, tileSize))
+  {
+    TWorldPath const & worldPath = m_worldPaths.at (index);
+    for (int i = 0, count = worldPath.size (); i < count; ++i)
+    {
+      points[i] = toViewport (worldPath.at (i), zoom, tileSize);
+    }
+  }
+  else
+  {
+    tileAdapter->coordinatesToViewport (path.constData (), path.size (), zoom, points.data ());
+  }
+
+  simplify (points);
+}
+
+CProjectedPaths::TWorldPath CProjectedPaths::worldPath (TPath const & path)
+{
+  // The ordinates of the whole path are computed at once (see CMercator).
+  QVector<double> ordinates (path.size ());
+  for (int i = 0, count = path.size (); i < count; ++i)
+  {
+    ordinates[i] = static_cast<double>(path.at (i).y ());
+  }
+
+  CMercator::ordinates (ordinates.constData (), ordinates.data (), ordinates.size ());
+
+  TWorldPath worldPath (path.size ());
+  for (int i = 0, count = path.size (); i < count; ++i)
+  {
+    double x     = (static_cast<double>(path.at (i).x ()) + 180) / 360;
+    double y     = (1 - ordinates.at (i) / M_PI) / 2;
+    worldPath[i] = { toWorld (x), toWorld (y) };
+  }
+
+  return worldPath;
+}
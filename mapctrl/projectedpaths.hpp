@@ -0,0 +1,112 @@
+﻿#ifndef PROJECTEDPATHS_HPP
+#define PROJECTEDPATHS_HPP
+
+#include "mapshape.hpp"
+#include <QPolygon>
+
+/*! \brief Pyramid of the paths projected on tile and simplified for each zoom.
+ *
+ *  The projection of a geo-coordinate needs a log and a tan. The vertexes of polylines and
+ *  polygons are projected at the first draw for a zoom and kept for this zoom until the tile
+ *  size or the geo-coordinates change. The draws only translate the points in widget coordinates
+ *  (see CMapShape::SViewportToWidget::toWidget).
+ *
+ *  Each level is simplified by the Douglas-Peucker algorithm with a tolerance of half a pixel,
+ *  after the removal of the vertexes falling in the same pixel. At low zooms, a contour of
+ *  hundreds of vertexes becomes some points. A path reduced to less than 3 points (polygon) or
+ *  to 1 point (polyline) is smaller than a pixel and drawn as a dot by the shapes.
+ *  A level has at most the number of vertexes of the paths. The low zooms keep few vertexes, but
+ *  from the zoom where the segments are longer than a pixel, a level keeps nearly all of them.
+ *  To bound the memory, only the levels within MaxLevelDistance zooms of the last zoom computed
+ *  are kept, at most 2 * MaxLevelDistance + 1 copies of the vertexes by shape.
+ *
+ *  With the integer storage (see CMapShape::setIntegerStorage), the vertexes are also converted
+ *  once by reset in 32 bits world coordinates, the Web Mercator pixels at zoom 24 for 256 pixels
+ *  tiles. The projection for a zoom is then a multiplication and a shift by vertex. Beyond this
+ *  precision, the geo-coordinates are projected as without integer storage.
+ */
+class CProjectedPaths
+{
+public:
+  /*! Maximum distance in zooms between a kept level and the last zoom computed. */
+  static int const MaxLevelDistance = 2;
+
+  /*! Point in world coordinates. The world [0, 1[ is mapped on [0, 2^32[. */
+  struct SWorldPoint
+  {
+    quint32 m_x, m_y;
+  };
+
+  using TWorldPath = QVector<SWorldPoint>;
+
+  /*! Returns the paths projected and simplified for the zoom. The level is computed if needed.
+   *  \param paths: The paths in geo-coordinates.
+   *  \param tileAdapter: The tile adapter defining the projection.
+   *  \param zoom: The zoom.
+   */
+  QVector<QPolygon> const & paths (TPaths const & paths, CTileAdapter const * tileAdapter, int zoom);
+
+  /*! Returns the path projected and simplified for the zoom. The level is computed if needed.
+   *  \param path: The path in geo-coordinates.
+   *  \param tileAdapter: The tile adapter defining the projection.
+   *  \param zoom: The zoom.
+   */
+  QPolygon const & path (TPath const & path, CTileAdapter const * tileAdapter, int zoom);
+
+  /*! Releases the pyramid. Must be called when the geo-coordinates change.
+   *  With the integer storage, the vertexes are converted in world coordinates.
+   */
+  void reset (TPaths const & paths);
+
+  /*! Releases the pyramid. Must be called when the geo-coordinates change.
+   *  With the integer storage, the vertexes are converted in world coordinates.
+   */
+  void reset (TPath const & path);
+
+  /*! Returns the world coordinates of a geo-coordinate. */
+  static SWorldPoint toWorld (TGeoCoord const & coordinates);
+
+  /*! Returns true if the world points can be projected by toViewport at this zoom, i.e. if
+   *  tileSize * 2^zoom does not exceed 2^32 (zoom 24 for 256 pixels tiles).
+   */
+  static bool hasWorldPrecision (int zoom, int tileSize)
+  {
+    return (static_cast<quint64>(tileSize) << zoom) <= (Q_UINT64_C (1) << 32);
+  }
+
+  /*! Returns the point on tile of a world point.
+   *  \param point: The world point.
+   *  \param zoom: The zoom.
+   *  \param tileSize: The tile size in pixels. tileSize * 2^zoom must not exceed 2^32 (see hasWorldPrecision).
+   */
+  static inline QPoint toViewport (SWorldPoint point, int zoom, int tileSize);
+
+  /*! Removes the vertexes not needed to draw the points with an error below tolerance pixels.
+   *  The first and the last points are kept.
+   */
+  static void simplify (QPolygon& points, double tolerance = 0.5);
+
+private:
+  QVector<QPolygon>& level (int size, CTileAdapter const * tileAdapter, int zoom, bool& valid);
+  void project (int index, TPath const & path, CTileAdapter const * tileAdapter, int zoom, QPolygon& points);
+  static TWorldPath worldPath (TPath const & path);
+  static quint32 toWorld (double v);
+
+private:
+  QVector<QVector<QPolygon>> m_levels;        //!< Projected and simplified vertexes by zoom.
+  QVector<TWorldPath>        m_worldPaths;    //!< Vertexes in world coordinates. Empty without integer storage.
+  quint32                    m_zooms    = 0;  //!< Bit z set when the level of zoom z is computed.
+  int                        m_tileSize = 0;  //!< Tile size of m_levels.
+};
+
+QPoint CProjectedPaths::toViewport (SWorldPoint point, int zoom, int tileSize)
+{
+  // The world size is tileSize * 2^zoom pixels. The half pixel rounds to the nearest pixel.
+  Q_ASSERT (hasWorldPrecision (zoom, tileSize));
+  quint64 worldSize = static_cast<quint64>(tileSize) << zoom;
+  int     x         = static_cast<int>((point.m_x * worldSize + 0x80000000) >> 32);
+  int     y         = static_cast<int>((point.m_y * worldSize + 0x80000000) >> 32);
+  return QPoint (x, y);
+}
+
+#endif // PROJECTEDPATHS_HPP
@@ -0,0 +1,249 @@
+﻿#include "simulatedtileadapter.hpp"
+#include <QPainter>
+#include <QBuffer>
+#include <QTimer>
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <cmath>
+
+/*! \brief The CSimulatedReply class is the reply of a simulated request.
+ *
+ *  After the latency, the reply fails or delivers the data by chunks at the rate allowed
+ *  by the bandwidth of the adapter.
+ */
+class CSimulatedReply : public QNetworkReply
+{
+public:
+  enum EOutcome { Success, Error, NotFound };
+
+  CSimulatedReply (CSimulatedTileAdapter* adapter, QNetworkRequest const & request,
+                   EOutcome outcome, int latency, QByteArray const & data);
+
+  void abort () override;
+  qint64 bytesAvailable () const override { return m_received - m_offset + QNetworkReply::bytesAvailable (); }
+  bool isSequential () const override { return true; }
+
+protected:
+  qint64 readData (char* data, qint64 maxSize) override;
+
+private:
+  void start ();
+  void deliver ();
+  void finish ();
+
+private:
+  static int const Tick = 10; //!< Delivery interval in ms.
+
+  CSimulatedTileAdapter* m_adapter;          //!< The adapter (parent).
+  EOutcome               m_outcome;          //!< The simulated result.
+  QByteArray             m_data;             //!< The tile image.
+  qint64                 m_received = 0;     //!< Number of bytes delivered.
+  qint64                 m_offset   = 0;     //!< Number of bytes read.
+  bool                   m_started  = false; //!< The latency is elapsed.
+  bool                   m_done     = false; //!< finished is emitted.
+  QTimer                 m_timer;            //!< Delivery timer.
+};
+
+CSimulatedReply::CSimulatedReply (CSimulatedTileAdapter* adapter, QNetworkRequest const & request,
+                                  EOutcome outcome, int latency, QByteArray const & data) :
+  QNetworkReply (adapter), m_adapter (adapter), m_outcome (outcome), m_data (data)
+{
+  setRequest (request);
+  setUrl (request.url ());
+  setOperation (QNetworkAccessManager::GetOperation);
+  open (QIODevice::ReadOnly | QIODevice::Unbuffered);
+  connect (&m_timer, &QTimer::timeout, this, [this] () { deliver (); });
+  QTimer::singleShot (latency, this, [this] () { start (); });
+}
+
+void CSimulatedReply::start ()
+{
+  if (!m_done)
+  {
+    m_started = true;
+    switch (m_outcome)
+    {
+      case Error :
+        ++m_adapter->m_statistics.m_errors;
+        setError (QNetworkReply::RemoteHostClosedError, QStringLiteral ("Simulated network error"));
+        emit errorOccurred (QNetworkReply::RemoteHostClosedError);
+        finish ();
+        break;
+
+      case NotFound :
+        ++m_adapter->m_statistics.m_notFound;
+        setAttribute (QNetworkRequest::HttpStatusCodeAttribute, 404);
+        setAttribute (QNetworkRequest::HttpReasonPhraseAttribute, QByteArray ("Not Found"));
+        emit metaDataChanged ();
+        setError (QNetworkReply::ContentNotFoundError, QStringLiteral ("Simulated 404"));
+        emit errorOccurred (QNetworkReply::ContentNotFoundError);
+        finish ();
+        break;
+
+      case Success :
+        ++m_adapter->m_activeReplies;
+        setAttribute (QNetworkRequest::HttpStatusCodeAttribute, 200);
+        setAttribute (QNetworkRequest::HttpReasonPhraseAttribute, QByteArray ("OK"));
+        setHeader (QNetworkRequest::ContentTypeHeader, QByteArray ("image/png"));
+        setHeader (QNetworkRequest::ContentLengthHeader, m_data.size ());
+        emit metaDataChanged ();
+        if (m_adapter->m_simulation.m_bandwidth > 0)
+        {
+          m_timer.start (Tick);
+        }
+
+        deliver ();
+        break;
+    }
+  }
+}
+
+void CSimulatedReply::deliver ()
+{
+  // The bandwidth is shared by the replies receiving data.
+  qint64 bandwidth = m_adapter->m_simulation.m_bandwidth;
+  qint64 chunk     = m_data.size () - m_received;
+  if (bandwidth > 0)
+  {
+    chunk = std::min (chunk, std::max<qint64> (1, bandwidth * Tick / 1000 / std::max (1, m_adapter->m_activeReplies)));
+  }
+
+  m_received                      += chunk;
+  m_adapter->m_statistics.m_bytes += chunk;
+  emit downloadProgress (m_received, m_data.size ());
+  emit readyRead ();
+  if (m_received == m_data.size () && !m_done)
+  {
+    finish ();
+  }
+}
+
+void CSimulatedReply::finish ()
+{
+  if (m_started && m_outcome == Success)
+  { // The reply does not share the bandwidth anymore.
+    --m_adapter->m_activeReplies;
+  }
+
+  m_done = true;
+  m_timer.stop ();
+  setFinished (true);
+  emit finished ();
+}
+
+void CSimulatedReply::abort ()
+{
+  if (!m_done)
+  {
+    ++m_adapter->m_statistics.m_aborted;
+    setError (QNetworkReply::OperationCanceledError, QStringLiteral ("Operation canceled"));
+    emit errorOccurred (QNetworkReply::OperationCanceledError);
+    finish ();
+  }
+}
+
+qint64 CSimulatedReply::readData (char* data, qint64 maxSize)
+{
+  qint64 size = std::min (maxSize, m_received - m_offset);
+  if (size <= 0)
+  {
+    return m_done ? -1 : 0;
+  }
+
+  std::memcpy (data, m_data.constData () + m_offset, static_cast<size_t>(size));
+  m_offset += size;
+  return size;
+}
+
+CSimulatedTileAdapter::CSimulatedTileAdapter (SSimulation const & simulation, int tileSize) :
+  CTileAdapter (QStringList (), "simulated", tileSize, 0, 19, false, NoDiskCache), m_simulation (simulation)
+{
+  setUrls (QStringList (QStringLiteral ("sim://tiles/%1/%2/%3.png")));
+  setIndexNames (QStringList (QStringLiteral ("Simulated")));
+}
+
+CSimulatedTileAdapter::~CSimulatedTileAdapter ()
+{
+  // The replies use the counters of this class, they are aborted before the destructor of CTileAdapter.
+  m_scheduler.clear ();
+  QList<QNetworkReply*> replies = m_replies.keys ();
+  for (QNetworkReply* reply : qAsConst (replies))
+  {
+    reply->abort ();
+  }
+}
+
+void CSimulatedTileAdapter::resetStatistics ()
+{
+  m_statistics = SStatistics ();
+  m_attempts.clear ();
+}
+
+QByteArray CSimulatedTileAdapter::tileImage (int x, int y, int z) const
+{
+  QImage image (m_tileSize, m_tileSize, QImage::Format_RGB32);
+  image.fill (QColor::fromHsv ((z * 40 + (x + y) * 15) % 360, 40, 235));
+
+  QPainter painter (&image);
+  painter.setPen (Qt::darkGray);
+  painter.drawRect (0, 0, m_tileSize - 1, m_tileSize - 1);
+  painter.drawText (image.rect (), Qt::AlignCenter, QStringLiteral ("%1/%2/%3").arg (z).arg (x).arg (y));
+  painter.end ();
+
+  QByteArray data;
+  QBuffer    buffer (&data);
+  buffer.open (QIODevice::WriteOnly);
+  image.save (&buffer, "PNG");
+  return data;
+}
+
+QNetworkReply* CSimulatedTileAdapter::createRequest (Operation op, QNetworkRequest const & request, QIODevice* outgoingData)
+{
+  QUrl url = request.url ();
+  if (url.scheme () != QLatin1String ("sim") || op != GetOperation)
+  {
+    return CTileAdapter::createRequest (op, request, outgoingData);
+  }
+
+  // sim://tiles/z/x/y.png
+  QStringList parts = url.path ().split ('/', Qt::SkipEmptyParts);
+  int         z     = parts.value (0).toInt ();
+  int         x     = parts.value (1).toInt ();
+  int         y     = parts.value (2).section ('.', 0, 0).toInt ();
+
+  // The generator depends on the seed, the tile and the attempt only.
+  TTileKey      key     = ::tileKey (x, y, z, 0);
+  int           attempt = m_attempts[key]++;
+  std::seed_seq seq { m_simulation.m_seed, static_cast<quint32>(key), static_cast<quint32>(key >> 32), static_cast<quint32>(attempt) };
+  std::mt19937  generator (seq);
+  auto          uniform = [&generator] () -> double { return (generator () >> 8) * (1.0 / 16777216.0); }; // [0, 1[
+
+  int latency = m_simulation.m_latencyMin;
+  if (m_simulation.m_latency == Uniform)
+  {
+    latency += static_cast<int>(uniform () * (m_simulation.m_latencyMax - m_simulation.m_latencyMin + 1));
+  }
+  else if (m_simulation.m_latency == Exponential)
+  {
+    double mean = std::max (0, m_simulation.m_latencyMean - m_simulation.m_latencyMin);
+    latency    += static_cast<int>(-std::log (1.0 - uniform ()) * mean);
+  }
+
+  latency = std::min (latency, std::max (m_simulation.m_latencyMin, m_simulation.m_latencyMax));
+
+  double                    draw    = uniform ();
+  CSimulatedReply::EOutcome outcome = CSimulatedReply::Success;
+  if (draw < m_simulation.m_errorRate)
+  {
+    outcome = CSimulatedReply::Error;
+  }
+  else if (draw < m_simulation.m_errorRate + m_simulation.m_notFoundRate)
+  {
+    outcome = CSimulatedReply::NotFound;
+  }
+
+  ++m_statistics.m_requests;
+  QByteArray data = outcome == CSimulatedReply::Success ? tileImage (x, y, z) : QByteArray ();
+  return new CSimulatedReply (this, request, outcome, latency, data);
+}
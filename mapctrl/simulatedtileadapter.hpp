@@ -0,0 +1,87 @@
+﻿#ifndef SIMULATEDTILEADAPTER_HPP
+#define SIMULATEDTILEADAPTER_HPP
+
+#include "tileadapter.hpp"
+#include <QHash>
+
+/*! \brief The CSimulatedTileAdapter class simulates a tile server without network.
+ *
+ *  The adapter overrides QNetworkAccessManager::createRequest. The requests to the url
+ *  sim://tiles/z/x/y.png are served by a local reply delivering a synthetic PNG. The other
+ *  requests are sent normally.
+ *  The latency, the bandwidth shared by the replies, the network errors and the 404 errors are simulated.
+ *  The simulation is deterministic: the outcome of a request depends only on the seed, the tile
+ *  and the number of previous requests of the tile, not on the request order.
+ *  It is used to measure the tile pipeline (time to fill the viewport, cache efficiency)
+ *  reproducibly and without loading public servers.
+ */
+class CSimulatedTileAdapter : public CTileAdapter
+{
+  Q_OBJECT
+public:
+  /*! Latency distributions. */
+  enum ELatency : quint8 { Constant,    //!< m_latencyMin.
+                           Uniform,     //!< Uniform in [m_latencyMin, m_latencyMax].
+                           Exponential, //!< m_latencyMin + exponential of mean m_latencyMean - m_latencyMin, bounded by m_latencyMax.
+                         };
+
+  /*! Parameters of the simulation. */
+  struct SSimulation
+  {
+    ELatency m_latency      = Exponential; //!< Latency distribution.
+    int      m_latencyMin   = 20;          //!< Minimum latency in ms.
+    int      m_latencyMean  = 80;          //!< Mean latency in ms.
+    int      m_latencyMax   = 2000;        //!< Maximum latency in ms.
+    qint64   m_bandwidth    = 0;           //!< Bytes per second shared by the replies. 0 means unlimited.
+    qreal    m_errorRate    = 0;           //!< Probability [0, 1] of a network error.
+    qreal    m_notFoundRate = 0;           //!< Probability [0, 1] of a 404 error.
+    quint32  m_seed         = 0;           //!< Seed of the pseudo random generator.
+  };
+
+  /*! Counters of the simulated requests. */
+  struct SStatistics
+  {
+    int    m_requests = 0; //!< Number of requests.
+    int    m_errors   = 0; //!< Number of network errors.
+    int    m_notFound = 0; //!< Number of 404 errors.
+    int    m_aborted  = 0; //!< Number of aborted requests.
+    qint64 m_bytes    = 0; //!< Number of delivered bytes.
+  };
+
+  /*! Constructor.
+   *  \param simulation: The parameters of the simulation.
+   *  \param tileSize: The size of the tiles in pixels.
+   */
+  CSimulatedTileAdapter (SSimulation const & simulation = SSimulation (), int tileSize = 256);
+
+  /*! Destructor. The running replies are aborted. */
+  ~CSimulatedTileAdapter () override;
+
+  /*! Returns the parameters of the simulation. */
+  SSimulation const & simulation () const { return m_simulation; }
+
+  /*! Sets the parameters of the simulation. The new parameters are used by the next requests. */
+  void setSimulation (SSimulation const & simulation) { m_simulation = simulation; }
+
+  /*! Returns the counters of the simulated requests. */
+  SStatistics const & statistics () const { return m_statistics; }
+
+  /*! Resets the counters and the number of requests of each tile. */
+  void resetStatistics ();
+
+  /*! Returns the synthetic PNG of the tile. */
+  QByteArray tileImage (int x, int y, int z) const;
+
+protected:
+  QNetworkReply* createRequest (Operation op, QNetworkRequest const & request, QIODevice* outgoingData = nullptr) override;
+
+private:
+  friend class CSimulatedReply;
+
+  SSimulation          m_simulation;        //!< The parameters.
+  SStatistics          m_statistics;        //!< The counters.
+  QHash<TTileKey, int> m_attempts;          //!< Number of requests of each tile.
+  int                  m_activeReplies = 0; //!< Number of replies sharing the bandwidth.
+};
+
+#endif // SIMULATEDTILEADAPTER_HPP
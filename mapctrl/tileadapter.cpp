@@ -1,9 +1,20 @@
 ﻿#include "tileadapter.hpp"
+#include "../tools/mercator.hpp"
 #include <QNetworkDiskCache>
 #include <QStandardPaths>
 #include <QPixmap>
+#include <QImageReader>
+#include <QBuffer>
 #include <QDir>
 #include <QDebug>
+#include <algorithm>
+#include <limits>
+
+// Initial capacity of a reply without Content-Length. It is the size of most encoded tiles.
+static qint64 const ReplyReserve = 32 * 1024;
+
+// Number of values converted at once by the batch projections, in a buffer on the stack.
+static int const ProjectionBatch = 256;
 
 CTileAdapter::CTileAdapter (QStringList const & urls, QString const & name, int tileSize,
                             int zoomMin, int zoomMax, bool swapCoordinates, int maxCacheSize) :
@@ -33,17 +44,33 @@ CTileAdapter::CTileAdapter (QStringList const & urls, QString const & name, int
     setCache (cache);
   }
 
+  m_decoder.setVectorTileRenderer (CTileDecoder::TVectorTileRenderer (new CVectorTileRenderer (SVectorTileStyle::defaultStyle (), m_tileSize)));
+  connect (&m_decoder, &CTileDecoder::tileDecoded, this, &CTileAdapter::tileDecoded);
+  connect (&m_scheduler, &CTileScheduler::requestReady, this, &CTileAdapter::sendRequest);
+  m_clock.start ();
   updatePixmapFormat ();
+  updateHosts ();
 }
 
 CTileAdapter::~CTileAdapter ()
 {
-  // Abort all pending network communications.
-  for (QMap<QNetworkReply*, QByteArray>::key_iterator it = m_replies.keyBegin (), end = m_replies.keyEnd (); it != end; ++it)
+  // Abort all pending network communications. The replies are disconnected first, abort emits
+  // finished and downloadFinished would modify m_replies and emit signals from the destructor.
+  m_scheduler.clear ();
+  QList<QNetworkReply*> replies = m_replies.keys ();
+  m_replies.clear ();
+  for (QNetworkReply* reply : qAsConst (replies))
   {
-    (*it)->abort ();
+    disconnect (reply, nullptr, this, nullptr);
+    reply->abort ();
   }
 
+  removeNetworkCache ();
+  delete m_diskCache; // The index is saved, the tiles are kept.
+}
+
+void CTileAdapter::removeNetworkCache ()
+{
   QNetworkDiskCache* cache = findChild<QNetworkDiskCache*> ();
   if (cache != nullptr)
   {
@@ -57,10 +84,95 @@ CTileAdapter::~CTileAdapter ()
   }
 }
 
+bool CTileAdapter::setPersistentDiskCache (int maxSize)
+{
+#ifdef Q_OS_WASM
+  Q_UNUSED (maxSize)
+  return false;
+#else
+  if (m_diskCache == nullptr)
+  {
+    removeNetworkCache ();
+    QString folder = QStandardPaths::writableLocation (QStandardPaths::CacheLocation);
+    folder        += QLatin1String ("/tilecache/") + m_name;
+    m_diskCache    = new CTileDiskCache (folder, maxSize < 0 ? -1 : maxSize * Q_INT64_C (1024) * 1024);
+
+    // The tiles stored in the removed cache must be requested again.
+    m_tiles.removeIf ([] (TTileKey, STile const & tile) { return tile.m_state == STile::Available; });
+  }
+  else if (maxSize >= 0)
+  {
+    m_diskCache->setMaxSize (maxSize * Q_INT64_C (1024) * 1024);
+  }
+
+  return true;
+#endif
+}
+
+void CTileAdapter::setVectorTileStyle (SVectorTileStyle const & style, qreal pixelRatio)
+{
+  QSet<TTileKey> canceled = m_decoder.setVectorTileRenderer (CTileDecoder::TVectorTileRenderer (new CVectorTileRenderer (style, m_tileSize, pixelRatio)));
+  for (TTileKey key : qAsConst (canceled))
+  { // Tiles read by the decoder (e.g. CLocalTileAdapter) are requested again.
+    STile const * tile = m_tiles.find (key);
+    if (tile != nullptr && tile->m_state == STile::Requested)
+    {
+      m_tiles.remove (key);
+    }
+  }
+
+  if (CVectorTileRenderer::isVectorFormat (m_imageFormat))
+  { // The encoded tiles are kept, only the images are drawn again.
+    m_tileCache.clearPixmaps ();
+    emit newTileAvailable ();
+  }
+}
+
 void CTileAdapter::setUrls (QStringList const & urls)
 {
   m_urls = urls;
   updatePixmapFormat ();
+  updateHosts ();
+  warmUp ();
+}
+
+void CTileAdapter::setUrlIndex (int index)
+{
+  if (index != m_urlIndex)
+  {
+    m_urlIndex = index;
+    warmUp ();
+  }
+}
+
+void CTileAdapter::updateHosts ()
+{
+  m_hosts.clear ();
+  m_hosts.reserve (m_urls.size ());
+  for (QString const & url : qAsConst (m_urls))
+  {
+    m_hosts.append (QUrl (url).host ());
+  }
+}
+
+void CTileAdapter::warmUp ()
+{
+#ifndef Q_OS_WASM
+  if (m_urlIndex >= 0 && m_urlIndex < m_urls.size ())
+  {
+    QUrl url (m_urls[m_urlIndex]);
+    if (url.scheme () == QLatin1String ("https"))
+    {
+#if QT_CONFIG(ssl)
+      connectToHostEncrypted (url.host (), static_cast<quint16>(url.port (443)));
+#endif
+    }
+    else if (url.scheme () == QLatin1String ("http"))
+    {
+      connectToHost (url.host (), static_cast<quint16>(url.port (80)));
+    }
+  }
+#endif
 }
 
 void CTileAdapter::updatePixmapFormat ()
@@ -86,6 +198,50 @@ TGeoCoord CTileAdapter::coordinatesToViewportF (TGeoCoord const & coordinates, i
   return TGeoCoord (x, y);
 }
 
+void CTileAdapter::coordinatesToViewportF (TGeoCoord const * coordinates, int count, int zoom, TGeoCoord* points) const
+{
+  TCoordType tt = ::powerOf2 (zoom) * m_tileSize;
+  TCoordType ordinates[ProjectionBatch];
+  for (int first = 0; first < count; first += ProjectionBatch)
+  {
+    int batch = std::min (ProjectionBatch, count - first);
+    for (int i = 0; i < batch; ++i)
+    {
+      ordinates[i] = coordinates[first + i].y ();
+    }
+
+    CMercator::ordinates (ordinates, ordinates, batch);
+    for (int i = 0; i < batch; ++i)
+    {
+      TCoordType x      = (coordinates[first + i].x () + 180) * tt / 360;
+      TCoordType y      = (1 - ordinates[i] / CPI) * tt / 2;
+      points[first + i] = TGeoCoord (x, y);
+    }
+  }
+}
+
+void CTileAdapter::coordinatesToViewport (TGeoCoord const * coordinates, int count, int zoom, QPoint* points) const
+{
+  TCoordType tt = ::powerOf2 (zoom) * m_tileSize;
+  TCoordType ordinates[ProjectionBatch];
+  for (int first = 0; first < count; first += ProjectionBatch)
+  {
+    int batch = std::min (ProjectionBatch, count - first);
+    for (int i = 0; i < batch; ++i)
+    {
+      ordinates[i] = coordinates[first + i].y ();
+    }
+
+    CMercator::ordinates (ordinates, ordinates, batch);
+    for (int i = 0; i < batch; ++i)
+    {
+      TCoordType x      = (coordinates[first + i].x () + 180) * tt / 360;
+      TCoordType y      = (1 - ordinates[i] / CPI) * tt / 2;
+      points[first + i] = QPoint (::qRound (x), ::qRound (y));
+    }
+  }
+}
+
 TGeoCoord CTileAdapter::viewportToCoordinatesF (TGeoCoord const & point, int zoom) const
 {
   TCoordType tt  = ::powerOf2 (zoom) * m_tileSize;
@@ -94,11 +250,57 @@ TGeoCoord CTileAdapter::viewportToCoordinatesF (TGeoCoord const & point, int zoo
   return TGeoCoord (lat, lon);
 }
 
-void CTileAdapter::tile (int x, int y, int z)
+void CTileAdapter::viewportToCoordinatesF (TGeoCoord const * points, int count, int zoom, TGeoCoord* coordinates) const
+{
+  TCoordType tt = ::powerOf2 (zoom) * m_tileSize;
+  TCoordType latitudes[ProjectionBatch];
+  for (int first = 0; first < count; first += ProjectionBatch)
+  {
+    int batch = std::min (ProjectionBatch, count - first);
+    for (int i = 0; i < batch; ++i)
+    {
+      latitudes[i] = (1 - points[first + i].y () * (2 / tt)) * CPI;
+    }
+
+    CMercator::latitudes (latitudes, latitudes, batch);
+    for (int i = 0; i < batch; ++i)
+    {
+      TCoordType lon         = (points[first + i].x () * (360 / tt)) - 180;
+      coordinates[first + i] = TGeoCoord (lon, latitudes[i]);
+    }
+  }
+}
+
+void CTileAdapter::tile (int x, int y, int z, CTileScheduler::EPriority priority)
 {
-  QString surl = this->url (x, y, z);
+  TTileKey key = tileKey (x, y, z);
+  m_tiles[key].m_state = STile::Requested; // Keep the number of failures.
+  requestTile (key, priority);
+}
+
+void CTileAdapter::requestTile (TTileKey key, CTileScheduler::EPriority priority)
+{
+  QByteArray data = m_diskCache != nullptr ? m_diskCache->data (key) : QByteArray ();
+  if (!data.isEmpty ())
+  { // Already downloaded by a previous session.
+    tileLoaded (key, data);
+  }
+  else
+  {
+    m_scheduler.enqueue (key, m_hosts.value (tileKeyIndex (key)), priority);
+  }
+}
+
+void CTileAdapter::sendRequest (TTileKey key, int priority)
+{
+  int     x     = tileKeyX (key);
+  int     y     = tileKeyY (key);
+  int     z     = tileKeyZ (key);
+  int     index = tileKeyIndex (key);
+  QString surl  = this->url (x, y, z, index);
   QUrl    url (surl);
   QNetworkRequest request (url);
+  request.setPriority (priority == CTileScheduler::Visible ? QNetworkRequest::NormalPriority : QNetworkRequest::LowPriority);
   if (m_userAgent)
   {
     request.setRawHeader ("User-Agent", "Mozilla/5.0 (PC; U; Intel; Linux; en) AppleWebKit/420+ (KHTML, like Gecko)");
@@ -117,33 +319,182 @@ void CTileAdapter::tile (int x, int y, int z)
              this, &CTileAdapter::downloadError);
     connect (reply, &QNetworkReply::finished, this, &CTileAdapter::downloadFinished);
     connect (reply, &QIODevice::readyRead, this, &CTileAdapter::downloadReadData);
-    m_replies.insert (reply, QByteArray ());
-#ifdef Q_OS_WASM
-    insert (reply->url ().toString (), QPixmap ());
-#else
-    insert (reply->url ().toString (), QString ());
-#endif
+    SReply data;
+    data.m_key = key;
+    m_replies.insert (reply, data);
+  }
+  else
+  {
+    m_tiles.remove (key);
+    m_scheduler.finished (m_hosts.value (index));
+    emit downloadFailed (key);
+  }
+}
+
+bool CTileAdapter::contains (int x, int y, int z) const
+{
+  STile const * tile = m_tiles.find (tileKey (x, y, z));
+  return tile != nullptr && (tile->m_state != STile::Failed || m_clock.elapsed () < tile->m_retryTime);
+}
+
+void CTileAdapter::abortRequests (TTileRects const & rects)
+{
+  int  urlIndex = m_urlIndex;
+  auto obsolete = [&rects, urlIndex] (TTileKey key) -> bool
+  {
+    if (tileKeyIndex (key) == urlIndex)
+    {
+      int    z = tileKeyZ (key);
+      QPoint tile (tileKeyX (key), tileKeyY (key));
+      for (STileRect const & rect : rects)
+      {
+        if (rect.m_z == z && rect.m_rect.contains (tile))
+        {
+          return false;
+        }
+      }
+    }
+
+    return true;
+  };
+
+  // Queued requests are simply removed.
+  QVector<TTileKey> keys = m_scheduler.removeIf (obsolete);
+  for (TTileKey key : qAsConst (keys))
+  {
+    m_tiles.remove (key);
+  }
+
+  QList<QNetworkReply*> replies;
+  for (QMap<QNetworkReply*, SReply>::const_iterator it = m_replies.cbegin (), end = m_replies.cend (); it != end; ++it)
+  {
+    if (obsolete (it.value ().m_key))
+    {
+      replies.append (it.key ());
+    }
+  }
+
+  // abort emits finished, downloadFinished removes the reply from m_replies.
+  for (QNetworkReply* reply : qAsConst (replies))
+  {
+    reply->abort ();
+  }
+}
+
+void CTileAdapter::promote (int x, int y, int z)
+{
+  TTileKey      key  = tileKey (x, y, z);
+  STile const * tile = m_tiles.find (key);
+  if (tile != nullptr && tile->m_state == STile::Requested)
+  {
+    m_scheduler.promote (key, CTileScheduler::Visible);
+  }
+}
+
+void CTileAdapter::prefetch (int x, int y, int z)
+{
+  if (z >= m_zoomMin && z <= m_zoomMax)
+  {
+    int count = tileCountOnZoom (z);
+    if (x >= 0 && x < count && y >= 0 && y < count && !contains (x, y, z))
+    {
+      tile (x, y, z, CTileScheduler::Prefetch);
+    }
   }
 }
 
 QPixmap CTileAdapter::fromCache (int x, int y, int z)
 {
-  QPixmap    pixmap;
-  QIODevice* device = cache ()->data (url (x, y, z));
-  if (device != nullptr && device->open (QIODevice::ReadOnly))
+  TTileKey      key  = tileKey (x, y, z);
+  STile const * tile = m_tiles.find (key);
+  if (tile == nullptr || tile->m_state != STile::Available)
+  {
+    return QPixmap ();
+  }
+
+  QPixmap pixmap = m_tileCache.pixmap (key);
+  if (pixmap.isNull () && !m_decoder.isPending (key))
+  {
+    // Encoded tile in memory, then in the disk cache.
+    QByteArray data = m_tileCache.data (key);
+    if (data.isEmpty ())
+    {
+      data = cachedData (key);
+      if (!data.isEmpty () && m_keepEncoded)
+      {
+        m_tileCache.insertData (key, data);
+      }
+    }
+
+    if (!data.isEmpty ())
+    {
+      m_decoder.decode (key, data, m_imageFormat);
+    }
+    else
+    { // Removed from all caches (always the case without disk cache), it is requested again.
+      m_tiles.remove (key);
+    }
+  }
+
+  return pixmap;
+}
+
+QPixmap CTileAdapter::ancestorFromCache (int x, int y, int z, QRect& source)
+{
+  QPixmap pixmap;
+  for (int d = 1; z - d >= m_zoomMin && (m_tileSize >> d) > 0 && pixmap.isNull (); ++d)
   {
-    pixmap.loadFromData (device->readAll (), m_imageFormat);
-    delete device;
+    TTileKey key = tileKey (x >> d, y >> d, z - d);
+    if (m_tileCache.contains (key)) // Do not count a miss.
+    {
+      pixmap = m_tileCache.pixmap (key);
+    }
+
+    if (!pixmap.isNull ())
+    {
+      // The ancestor is divided in 2^d x 2^d parts. The source is in pixels of the pixmap.
+      int size = qRound ((m_tileSize >> d) * pixmap.devicePixelRatio ());
+      int mask = (1 << d) - 1;
+      source   = QRect ((x & mask) * size, (y & mask) * size, size, size);
+    }
   }
 
   return pixmap;
 }
 
+QByteArray CTileAdapter::cachedData (TTileKey key)
+{
+  QByteArray             data;
+  QAbstractNetworkCache* diskCache = cache ();
+  if (m_diskCache != nullptr)
+  {
+    data = m_diskCache->data (key);
+  }
+  else if (diskCache != nullptr)
+  {
+    QIODevice* device = diskCache->data (url (tileKeyX (key), tileKeyY (key), tileKeyZ (key), tileKeyIndex (key)));
+    if (device != nullptr)
+    {
+      if (device->open (QIODevice::ReadOnly))
+      {
+        data = device->readAll ();
+      }
+
+      delete device;
+    }
+  }
+
+  return data;
+}
+
 void CTileAdapter::downloadError (QNetworkReply::NetworkError err)
 {
-  auto reply = static_cast<QNetworkReply*>(sender ());
-  m_message  = reply->errorString ();
-  qDebug () << QStringLiteral ("Download error: ") << err << QStringLiteral (" (") << m_message << ')';
+  if (err != QNetworkReply::OperationCanceledError)
+  {
+    auto reply = static_cast<QNetworkReply*>(sender ());
+    m_message  = reply->errorString ();
+    qDebug () << QStringLiteral ("Download error: ") << err << QStringLiteral (" (") << m_message << ')';
+  }
 }
 
 void CTileAdapter::downloadFinished ()
@@ -151,26 +502,159 @@ void CTileAdapter::downloadFinished ()
   auto reply = static_cast<QNetworkReply*>(sender ());
   if (reply != nullptr)
   {
-    QByteArray& data = m_replies[reply];
-    QPixmap     pixmap;
-    pixmap.loadFromData (data, m_imageFormat.constData ());
-    (*this)[reply->url ().toString ()] =
-#ifdef Q_OS_WASM
-      pixmap;
-#endif
+    SReply&                     data  = m_replies[reply];
+    QNetworkReply::NetworkError error = reply->error ();
+    if (error == QNetworkReply::NoError)
+    {
+      readReply (reply, data);
+      if (data.m_data.capacity () - data.m_data.size () > data.m_data.size () / 4)
+      { // Unknown size (no Content-Length), the tile is kept in the memory cache without the unused capacity.
+        data.m_data.squeeze ();
+      }
+
+      if (!isTileData (reply, data.m_data))
+      { // Error page of a proxy or a captive portal, truncated image...
+        retryLater (data.m_key);
+        emit downloadFailed (data.m_key);
+      }
+      else
+      {
+        if (m_diskCache != nullptr)
+        {
+          m_diskCache->insert (data.m_key, data.m_data);
+        }
+
+        emit tileDownloaded (data.m_key, data.m_data);
+        tileLoaded (data.m_key, data.m_data);
+      }
+    }
+    else if (error == QNetworkReply::OperationCanceledError)
+    { // Aborted, the tile can be requested again.
+      m_tiles.remove (data.m_key);
+      emit downloadFailed (data.m_key);
+    }
+    else
+    {
+      retryLater (data.m_key);
+      emit downloadFailed (data.m_key);
+    }
+
+    m_scheduler.finished (m_hosts.value (tileKeyIndex (data.m_key)));
     m_replies.remove (reply);
     reply->deleteLater ();
-    emit newTileAvailable ();
   }
 }
 
+void CTileAdapter::tileLoaded (TTileKey key, QByteArray const & data)
+{
+  // The tile is available as soon as it is loaded, its data is in the memory or disk caches.
+  // With decoding, the failures are reseted only when the data is an image.
+  STile& tile  = m_tiles[key];
+  tile.m_state = STile::Available;
+  if (!m_decoding)
+  {
+    tile.m_failures = 0;
+  }
+  else
+  {
+    if (m_keepEncoded)
+    {
+      m_tileCache.insertData (key, data);
+    }
+
+    m_decoder.decode (key, data, m_imageFormat);
+  }
+}
+
+bool CTileAdapter::isTileData (QNetworkReply* reply, QByteArray const & data) const
+{
+  // The content type is checked when the server gives it, the header of the raster formats is also checked.
+  QString type = reply->header (QNetworkRequest::ContentTypeHeader).toString ();
+  bool    tile = !data.isEmpty () && !type.startsWith (QLatin1String ("text/"), Qt::CaseInsensitive);
+  if (tile && !CVectorTileRenderer::isVectorFormat (m_imageFormat))
+  {
+    QBuffer buffer;
+    buffer.setData (data);
+    buffer.open (QIODevice::ReadOnly);
+    tile = !QImageReader::imageFormat (&buffer).isEmpty ();
+  }
+
+  return tile;
+}
+
+void CTileAdapter::retryLater (TTileKey key)
+{
+  // Exponential delay, from 2s to about 8mn.
+  STile& tile      = m_tiles[key];
+  tile.m_state     = STile::Failed;
+  tile.m_retryTime = m_clock.elapsed () + (Q_INT64_C (2000) << std::min<int> (tile.m_failures, 8));
+  if (tile.m_failures < 255)
+  {
+    ++tile.m_failures;
+  }
+}
+
+void CTileAdapter::tileMissing (TTileKey key)
+{
+  STile& tile      = m_tiles[key];
+  tile.m_state     = STile::Failed;
+  tile.m_retryTime = std::numeric_limits<qint64>::max ();
+}
+
 void CTileAdapter::downloadReadData ()
 {
   auto reply = static_cast<QNetworkReply*>(sender ());
   if (reply != nullptr)
   {
-    QByteArray& data = m_replies[reply];
-    data            += reply->readAll ();
+    readReply (reply, m_replies[reply]);
+  }
+}
+
+void CTileAdapter::readReply (QNetworkReply* reply, SReply& data)
+{
+  qint64 available = reply->bytesAvailable ();
+  if (available > 0)
+  {
+    int size = data.m_data.size ();
+    if (size == 0)
+    { // One allocation for the whole tile when the server gives its size.
+      bool   ok;
+      qint64 length = reply->header (QNetworkRequest::ContentLengthHeader).toLongLong (&ok);
+      data.m_data.reserve (static_cast<int>(ok && length > 0 ? std::max (length, available) : std::max (available, ReplyReserve)));
+    }
+    else if (size + available > data.m_data.capacity ())
+    {
+      data.m_data.reserve (static_cast<int>(std::max<qint64> (size + available, 2 * data.m_data.capacity ())));
+    }
+
+    // Read directly at the end of the buffer, the capacity is not exceeded so resize does not reallocate.
+    data.m_data.resize (static_cast<int>(size + available));
+    qint64 read = reply->read (data.m_data.data () + size, available);
+    data.m_data.resize (static_cast<int>(size + std::max<qint64> (0, read)));
+  }
+}
+
+void CTileAdapter::tileDecoded (TTileKey key, QImage const & image)
+{
+  STile* tile = m_tiles.find (key);
+  if (tile != nullptr)
+  {
+    if (!image.isNull ())
+    {
+      tile->m_failures = 0;
+      m_tileCache.insert (key, QPixmap::fromImage (image));
+      emit newTileAvailable ();
+    }
+    else
+    { // Not an image (error page, truncated or corrupt data), it is removed from the caches and downloaded later.
+      m_tileCache.remove (key);
+      if (m_diskCache != nullptr)
+      {
+        m_diskCache->remove (key);
+      }
+
+      retryLater (key);
+    }
   }
 }
 
@@ -2,8 +2,14 @@
 #define TILEADAPTER_HPP
 
 #include "mapshape.hpp"
+#include "tilecache.hpp"
+#include "tiledecoder.hpp"
+#include "tilescheduler.hpp"
+#include "tilediskcache.hpp"
+#include "../tools/flathash.hpp"
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
+#include <QElapsedTimer>
 
 /*! MAPCTRL_VERSION is (major << 16) + (minor << 8) + patch. */
 #define MAPCTRL_VERSION 0x010000
@@ -13,25 +19,42 @@
 using TCopyright = QPair<QString, QString>;
 using TCopyrights = QList<TCopyright>;
 
+/*! A rectangle of tiles at a zoom level. The rectangle contains tile coordinates (not pixels). */
+struct STileRect
+{
+  STileRect () = default;
+  STileRect (int z, QRect const & rect) : m_z (z), m_rect (rect) {}
+
+  int   m_z = 0; //!< The zoom level.
+  QRect m_rect;  //!< Tile coordinates, right and bottom included.
+};
+
+using TTileRects = QVector<STileRect>;
+
 /*! \brief The CTileAdapter base class used to manage tiles from tile servers.
- * It is used by COsmTileAdapter and CEsriTileAdapter.
+ * It is used by COsmTileAdapter, CEsriTileAdapter, CMBTilesAdapter, CTilePackAdapter and CLocalTileAdapter (offline).
+ *
+ * The tiles in a vector format (PBF, MVT, see imageFormat) are drawn by a CVectorTileRenderer
+ * in place of the image decoding. The style can be changed without loading the tiles again.
+ *
+ * The requested tiles are stored in a flat hash table indexed by TTileKey. The urls are
+ * only formatted when a network request is sent or when the disk cache is read.
+ * The requests are queued in a CTileScheduler which sends them by priority within
+ * the connection and rate limits of the servers.
  */
-class CTileAdapter : public QNetworkAccessManager,
-#ifdef Q_OS_WASM
-    public QMap<QString, QPixmap>
-#else
-    public QMap<QString, QString>
-#endif
+class CTileAdapter : public QNetworkAccessManager
 {
   Q_OBJECT
 public:
+  enum { NoDiskCache = -2 }; //!< maxCacheSize value of the constructor to not create the disk cache.
+
   /*! Contructor.
    *
    * For all systems excepted web assembly, all tiles are stored in disque (cache) in the standard cache location.
    * Windows: C:/Users/<USER>/AppData/Local/<APPNAME>/cache
    * MacOs: ~/Library/Caches/<APPNAME>
    * Linux: ~/.cache/<APPNAME>
-   * WAsm: no cache.
+   * WAsm: no disk cache, the tiles are kept encoded in the bounded memory cache (see tileCache).
    *
    *  \param url: The url format to retreive one tile from the server.
    *  \param name: The name of the adapter. This name is used to create the folder where tile files ar stored.
@@ -53,7 +76,7 @@ public:
    * Windows: C:/Users/<USER>/AppData/Local/<APPNAME>/cache
    * MacOs: ~/Library/Caches/<APPNAME>
    * Linux: ~/.cache/<APPNAME>
-   * WAsm: no cache.
+   * WAsm: no disk cache, the tiles are kept encoded in the bounded memory cache (see tileCache).
    *
    *  \param url: The url format to retreive one tile from the server.
    *  \param name: The name of the adapter. This name is used to create the folder where tile files ar stored.
@@ -63,6 +86,7 @@ public:
    *  \param swapCoordinates: false (default) for server accepting %1=z, %2=x, %3=y (Osm).
    *                          true for server accepting %1=z, %2=y, %3=x (Esri).
    *  \param maxCacheSize: The size cache in Mbytes. -1 (default) means 50Mbytes. The minimum cache size is 10MByes.
+   *                       NoDiskCache means no disk cache (e.g. offline tile sources).
    *                       For web asembly, this member is not use (no cache).
    */
   CTileAdapter (QStringList const & urls, QString const & name, int tileSize = 256,
@@ -70,7 +94,7 @@ public:
                 int maxCacheSize = -1);
 
   /*! Destructor.
-   *  The cache is cleared.
+   *  The disk cache is cleared excepted the persistent disk cache (see setPersistentDiskCache).
    */
   ~CTileAdapter () override;
 
@@ -81,7 +105,7 @@ public:
   void setIndexNames (QStringList const & indexNames) { m_indexNames = indexNames; }
 
   int urlIndex () const { return m_urlIndex; }
-  void setUrlIndex (int index) { m_urlIndex = index; }
+  void setUrlIndex (int index);
 
   /*! Returns the tile adapter name. */
   QString const & name () const { return m_name; }
@@ -95,18 +119,109 @@ public:
   /*! Sets the tile image format. */
   void setImageFormat (QByteArray const & format) { m_imageFormat = format; }
 
+  /*! Returns the tile image format. */
+  QByteArray const & imageFormat () const { return m_imageFormat; }
+
+  /*! Enables or disables the decoding of the loaded tiles (enabled by default).
+   *  Tools without display (e.g. cache seeding) disable it, the tiles are only stored in the disk cache.
+   */
+  void setDecoding (bool decoding) { m_decoding = decoding; }
+
+  /*! Returns true if the loaded tiles are decoded. */
+  bool decoding () const { return m_decoding; }
+
+  /*! Sets the style of the vector tiles.
+   *  The decoded tiles are removed from the memory cache and drawn again from their encoded data.
+   *  \param style: The style.
+   *  \param pixelRatio: The device pixel ratio of the tiles (e.g. QWidget::devicePixelRatioF).
+   */
+  void setVectorTileStyle (SVectorTileStyle const & style, qreal pixelRatio = 1);
+
+  /*! Returns the style of the vector tiles. */
+  SVectorTileStyle const & vectorTileStyle () const { return m_decoder.vectorTileRenderer ()->style (); }
+
   /*! Returns the size of tiles. */
   int tileSize () const { return m_tileSize; }
 
-  /*! Sends the request to download tile. */
-  void tile (int x, int y, int z);
+  /*! Returns the identifier of the tile for the actual url index. */
+  TTileKey tileKey (int x, int y, int z) const { return ::tileKey (x, y, z, m_urlIndex); }
+
+  /*! Returns true if the tile has been requested (downloaded or download in progress).
+   *  A tile whose download failed is considered as not requested when its retry delay is elapsed.
+   */
+  bool contains (int x, int y, int z) const;
+
+  /*! Queues the request to download tile.
+   *  \param x, y, z: The tile coordinates.
+   *  \param priority: The request priority. The visible tiles are sent before the prefetched tiles.
+   */
+  void tile (int x, int y, int z, CTileScheduler::EPriority priority = CTileScheduler::Visible);
+
+  /*! Queues the prefetch request to download tile if it is not yet requested.
+   *  Tiles outside [0, tileCountOnZoom (z) - 1] and zooms outside [zoomMin, zoomMax] are ignored.
+   */
+  void prefetch (int x, int y, int z);
+
+  /*! Raises the priority of a tile queued by prefetch to the priority of the visible tiles. */
+  void promote (int x, int y, int z);
+
+  /*! Aborts the downloads of the tiles outside the rectangles and of the other url indexes.
+   *  The aborted tiles are removed from the tile index and can be requested again.
+   */
+  void abortRequests (TTileRects const & rects);
+
+  /*! Returns the number of downloads in progress. */
+  int requestCount () const { return m_replies.size (); }
+
+  /*! Returns the request scheduler as a reference.
+   *  Use it to change the connection and rate limits or to set the screen center.
+   */
+  CTileScheduler& scheduler () { return m_scheduler; }
+
+  /*! Opens the connection to the server of the actual url index before the first tile request. */
+  void warmUp ();
 
-  /*! Returns the downloaded image of tile. */
+  /*! Returns the downloaded image of tile.
+   *  The tile is first searched in the memory cache of decoded tiles. If it is not found,
+   *  its encoded data is searched in the memory cache, then in the disk cache, and sent to
+   *  the decoder. In this case a null pixmap is returned and newTileAvailable is emitted
+   *  when the tile is decoded. A tile found nowhere is forgotten to be downloaded again.
+   */
   QPixmap fromCache (int x, int y, int z);
 
+  /*! Returns the nearest ancestor (z - 1, z - 2...) of the tile already decoded in memory.
+   *  It is drawn scaled up while the tile is loading. The ancestor is marked as recently used.
+   *  \param x, y, z: The tile coordinates.
+   *  \param source: The part of the ancestor covering the tile.
+   *  \return The ancestor or a null pixmap if no ancestor is in memory.
+   */
+  QPixmap ancestorFromCache (int x, int y, int z, QRect& source);
+
+  /*! Returns the memory cache of decoded tiles as a reference.
+   *  Use it to change the budget in bytes or to read hit and miss counters.
+   */
+  CTileCache& tileCache () { return m_tileCache; }
+
+  /*! Returns the memory cache of decoded tiles as a const reference. */
+  CTileCache const & tileCache () const { return m_tileCache; }
+
+  /*! Replaces the disk cache cleared by the destructor by a persistent disk cache.
+   *  The tiles are stored in <CacheLocation>/tilecache/<name> and are reused by the next adapter
+   *  with the same name, so a restart or a provider switch does not download the tiles again.
+   *  \param maxSize: The budget in Mbytes. -1 (default) means 100Mbytes.
+   *  \return false for web assembly (no persistent storage).
+   */
+  bool setPersistentDiskCache (int maxSize = -1);
+
+  /*! Returns the persistent disk cache or nullptr if it is not used. */
+  CTileDiskCache* persistentDiskCache () { return m_diskCache; }
+
   /*! Returns the url of the tile. */
   inline QString url (int x, int y, int z);
 
+  /*! Returns the url of the tile for the url index. */
+  inline QString url (int x, int y, int z, int index);
+
   /*! Returns the point on tile from the coordinates and zoom.
    *
    *  \param coordinates: The point location (longitude, latitude).
@@ -125,6 +240,26 @@ public:
    */
   TGeoCoord coordinatesToViewportF (TGeoCoord const & coordinates, int zoom) const;
 
+  /*! Returns the points on tile of a set of coordinates.
+   *  The logarithms and tangents are computed by SIMD approximations (see CMercator).
+   *
+   *  \param coordinates: The point locations (longitude, latitude).
+   *  \param count: The number of points.
+   *  \pamam zoom: The current zoom [minZoom, maxZoom].
+   *  \param points: The points on tile. Must have room for count points.
+   */
+  void coordinatesToViewport (TGeoCoord const * coordinates, int count, int zoom, QPoint* points) const;
+
+  /*! Returns the points on tile of a set of coordinates without integer truncature.
+   *  The logarithms and tangents are computed by SIMD approximations (see CMercator).
+   *
+   *  \param coordinates: The point locations (longitude, latitude).
+   *  \param count: The number of points.
+   *  \pamam zoom: The current zoom [minZoom, maxZoom].
+   *  \param points: The points on tile. Must have room for count points. Can be coordinates.
+   */
+  void coordinatesToViewportF (TGeoCoord const * coordinates, int count, int zoom, TGeoCoord* points) const;
+
    /*! Returns the coodinates from point on tile zoom.
    *
    *  \param point: The point on tile.
@@ -143,6 +278,16 @@ public:
    */
   TGeoCoord viewportToCoordinatesF (TGeoCoord const & point, int zoom) const;
 
+  /*! Returns the coodinates of a set of points on tile.
+   *  The arc tangents and hyperbolic sines are computed by SIMD approximations (see CMercator).
+   *
+   *  \param points: The points on tile.
+   *  \param count: The number of points.
+   *  \pamam zoom: The current zoom [minZoom, maxZoom].
+   *  \param coordinates: The point locations (longitude, latitude). Must have room for count points. Can be points.
+   */
+  void viewportToCoordinatesF (TGeoCoord const * points, int count, int zoom, TGeoCoord* coordinates) const;
+
   /*! Returns the min of zoom. */
   int zoomMin () const { return m_zoomMin; }
 
@@ -197,12 +342,44 @@ protected slots:
   /*! Read downloaded data. */
   void downloadReadData ();
 
+  /*! Sends the network request of a tile. Called by the scheduler. */
+  void sendRequest (TTileKey key, int priority);
+
+  /*! The tile image is decoded. Store the tile and emit newTileAvailable. */
+  void tileDecoded (TTileKey key, QImage const & image);
+
 signals:
   /*! Download is finished. The tile image is ready. */
   void newTileAvailable ();
 
+  /*! The tile is downloaded. It is emitted before the decoding. */
+  void tileDownloaded (TTileKey key, QByteArray const & data);
+
+  /*! The download of the tile failed, was aborted or could not be sent. Every sent request ends with
+   *  tileDownloaded or downloadFailed.
+   */
+  void downloadFailed (TTileKey key);
+
 protected:
   void updatePixmapFormat ();
+  void updateHosts ();
+  void removeNetworkCache ();
+
+  /*! Loads the tile. The default implementation queues the network request in the scheduler.
+   *  Offline tile sources override it to read the tile data without network.
+   */
+  virtual void requestTile (TTileKey key, CTileScheduler::EPriority priority);
+
+  /*! Returns the stored data of an available tile. Called when the decoded tile is not in the memory cache.
+   *  The default implementation reads the disk cache.
+   */
+  virtual QByteArray cachedData (TTileKey key);
+
+  /*! The data of the tile is loaded. The tile is available and the data is sent to the decoder. */
+  void tileLoaded (TTileKey key, QByteArray const & data);
+
+  /*! The tile does not exist in an offline source. It is never requested again. */
+  void tileMissing (TTileKey key);
 
 protected:
   QString     m_name;                    //!< Name.
@@ -217,9 +394,47 @@ protected:
   int m_zoomMin = 3;  //!< zoom min
   int m_zoomMax = 19; //!< zoom max
 
-  QMap<QNetworkReply*, QByteArray> m_replies; //!< Map of network replies
+  /*! Entry of the tile index. */
+  struct STile
+  {
+    enum EState : quint8 { Requested, //!< The download is in progress.
+                           Available, //!< The tile has been downloaded.
+                           Failed,    //!< The download failed. It is retried after m_retryTime.
+                         };
+
+    EState m_state     = Requested; //!< The download state.
+    quint8 m_failures  = 0;         //!< Number of consecutive failed downloads.
+    qint64 m_retryTime = 0;         //!< Time (see m_clock) from which a failed tile can be requested again.
+  };
+
+  /*! Downloaded data of a network reply. */
+  struct SReply
+  {
+    TTileKey   m_key;  //!< The tile identifier.
+    QByteArray m_data; //!< The downloaded data.
+  };
+
+  /*! Appends the available bytes of the reply at data without intermediate buffer. */
+  void readReply (QNetworkReply* reply, SReply& data);
+
+  /*! Returns true if the downloaded data looks like a tile and not like an error page. */
+  bool isTileData (QNetworkReply* reply, QByteArray const & data) const;
+
+  /*! Marks the tile as failed. It can be requested again after a delay growing with the failures. */
+  void retryLater (TTileKey key);
+
+  CFlatHash<STile>                 m_tiles;               //!< Index of the requested tiles.
+  QElapsedTimer                    m_clock;               //!< Clock of retry delays.
+  QMap<QNetworkReply*, SReply>     m_replies;             //!< Map of network replies
+  CTileCache                       m_tileCache;           //!< Memory cache of decoded tiles.
+  CTileDiskCache*                  m_diskCache = nullptr; //!< Persistent disk cache.
+  CTileDecoder                     m_decoder;             //!< Decoder of downloaded tiles.
+  CTileScheduler                   m_scheduler;           //!< Queue of requests.
+  QStringList                      m_hosts;               //!< Host of each url.
   TCopyrights                      m_copyrights;
   bool                             m_userAgent      = false;
+  bool                             m_decoding       = true;
+  bool                             m_keepEncoded    = true; //!< Keep the encoded tiles in the memory cache.
   bool                             m_swapCoordinate = false;
 };
 
@@ -229,15 +444,20 @@ int CTileAdapter::tileCountOnZoom (int zoom)
 }
 
 QString CTileAdapter::url (int x, int y, int z)
+{
+  return url (x, y, z, m_urlIndex);
+}
+
+QString CTileAdapter::url (int x, int y, int z, int index)
 {
   if (m_swapCoordinate)
   {
     std::swap (x, y);
   }
 
-  bool apiKey = m_urls[m_urlIndex].endsWith ("%4");
-  return !apiKey ? m_urls[m_urlIndex].arg (z).arg (x).arg (y)
-                : m_urls[m_urlIndex].arg (z).arg (x).arg (y).arg (m_apiKey);
+  bool apiKey = m_urls[index].endsWith ("%4");
+  return !apiKey ? m_urls[index].arg (z).arg (x).arg (y)
+                : m_urls[index].arg (z).arg (x).arg (y).arg (m_apiKey);
 }
 
 QPoint CTileAdapter::coordinatesToWidget (TGeoCoord const & geoLoc, CMapShape::SViewportToWidget const & vw)
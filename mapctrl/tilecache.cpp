@@ -0,0 +1,165 @@
+﻿#include "tilecache.hpp"
+#include <QVector>
+#include <QPair>
+#include <algorithm>
+#include <cstdlib>
+
+// Staleness of one zoom level between a tile and the actual zoom, in number of uses of the cache.
+static qint64 const ZoomPenalty = 64;
+
+CTileCache::CTileCache (int maxCost) : m_maxCost (maxCost == -1 ? 64 * 1024 * 1024 : maxCost)
+{
+}
+
+void CTileCache::setMaxCost (int maxCost)
+{
+  m_maxCost = maxCost;
+  evict ();
+}
+
+void CTileCache::setDecodedShare (int percent)
+{
+  m_decodedShare = qBound (0, percent, 100);
+  evict ();
+}
+
+bool CTileCache::contains (TTileKey key) const
+{
+  SEntry const * entry = m_entries.find (key);
+  return entry != nullptr && !entry->m_pixmap.isNull ();
+}
+
+bool CTileCache::containsData (TTileKey key) const
+{
+  SEntry const * entry = m_entries.find (key);
+  return entry != nullptr && !entry->m_data.isEmpty ();
+}
+
+CTileCache::SEntry& CTileCache::touch (TTileKey key)
+{
+  SEntry& entry   = m_entries[key];
+  entry.m_lastUse = ++m_clock;
+  return entry;
+}
+
+QPixmap CTileCache::pixmap (TTileKey key)
+{
+  QPixmap pixmap;
+  if (contains (key))
+  {
+    pixmap = touch (key).m_pixmap;
+    ++m_hits;
+  }
+  else
+  {
+    ++m_misses;
+  }
+
+  return pixmap;
+}
+
+QByteArray CTileCache::data (TTileKey key)
+{
+  return containsData (key) ? touch (key).m_data : QByteArray ();
+}
+
+void CTileCache::insert (TTileKey key, QPixmap const & pixmap)
+{
+  if (!pixmap.isNull ())
+  {
+    SEntry& entry  = touch (key);
+    m_decodedCost += cost (pixmap) - cost (entry.m_pixmap);
+    entry.m_pixmap = pixmap;
+    evict ();
+  }
+}
+
+void CTileCache::insertData (TTileKey key, QByteArray const & data)
+{
+  if (!data.isEmpty ())
+  {
+    SEntry& entry  = touch (key);
+    m_encodedCost += data.size () - entry.m_data.size ();
+    entry.m_data   = data;
+    evict ();
+  }
+}
+
+void CTileCache::remove (TTileKey key)
+{
+  SEntry const * entry = m_entries.find (key);
+  if (entry != nullptr)
+  {
+    m_decodedCost -= cost (entry->m_pixmap);
+    m_encodedCost -= entry->m_data.size ();
+    m_entries.remove (key);
+  }
+}
+
+void CTileCache::clear ()
+{
+  m_entries.clear ();
+  m_decodedCost = 0;
+  m_encodedCost = 0;
+}
+
+void CTileCache::clearPixmaps ()
+{
+  m_entries.removeIf ([] (TTileKey, SEntry const & entry) { return entry.m_data.isEmpty (); });
+
+  QVector<TTileKey> keys;
+  keys.reserve (static_cast<int>(m_entries.size ()));
+  m_entries.forEach ([&keys] (TTileKey key, SEntry const &) { keys.append (key); });
+  for (TTileKey key : qAsConst (keys))
+  {
+    m_entries.find (key)->m_pixmap = QPixmap ();
+  }
+
+  m_decodedCost = 0;
+}
+
+void CTileCache::evict ()
+{
+  qint64 decodedMax = decodedMaxCost ();
+  if (m_decodedCost > decodedMax || m_decodedCost + m_encodedCost > m_maxCost)
+  {
+    // The stalest tiles first. The cache is reduced to 90% to not evict at each insert.
+    QVector<QPair<qint64, TTileKey>> tiles;
+    tiles.reserve (static_cast<int>(m_entries.size ()));
+    m_entries.forEach ([this, &tiles] (TTileKey key, SEntry const & entry)
+    {
+      qint64 staleness = static_cast<qint64>(m_clock - entry.m_lastUse) + ZoomPenalty * std::abs (tileKeyZ (key) - m_zoom);
+      tiles.append (qMakePair (staleness, key));
+    });
+
+    std::sort (tiles.begin (), tiles.end (), [] (QPair<qint64, TTileKey> const & t1, QPair<qint64, TTileKey> const & t2)
+                                             { return t1.first > t2.first; });
+
+    // First the pixmaps while the decoded tiles exceed their share or the cache exceeds the budget.
+    qint64 decodedTarget = decodedMax - decodedMax / 10;
+    qint64 target        = m_maxCost - m_maxCost / 10;
+    for (int i = 0, count = tiles.size (); i < count; ++i)
+    {
+      SEntry* entry = m_entries.find (tiles[i].second);
+      if (!entry->m_pixmap.isNull () && (m_decodedCost > decodedTarget || m_decodedCost + m_encodedCost > target))
+      {
+        m_decodedCost  -= cost (entry->m_pixmap);
+        entry->m_pixmap = QPixmap ();
+      }
+    }
+
+    // Then the encoded tiles while the cache exceeds the budget.
+    for (int i = 0, count = tiles.size (); i < count && m_decodedCost + m_encodedCost > target; ++i)
+    {
+      remove (tiles[i].second);
+    }
+
+    // Entries without pixmap and data are useless.
+    m_entries.removeIf ([] (TTileKey, SEntry const & entry) { return entry.m_pixmap.isNull () && entry.m_data.isEmpty (); });
+  }
+}
+
+int CTileCache::cost (QPixmap const & pixmap)
+{
+  return pixmap.width () * pixmap.height () * (pixmap.depth () >> 3);
+}
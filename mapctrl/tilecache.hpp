@@ -0,0 +1,127 @@
+﻿#ifndef TILECACHE_HPP
+#define TILECACHE_HPP
+
+#include "tilekey.hpp"
+#include "../tools/flathash.hpp"
+#include <QPixmap>
+#include <QByteArray>
+
+/*! \brief The CTileCache class is the memory cache of tiles.
+ *
+ *  The tiles are identified by x, y, z and the url index of the tile adapter packed in a TTileKey.
+ *  The cache has two tiers sharing one budget in bytes:
+ *  - The encoded tiles (PNG, JPEG...), about ten times smaller than the decoded tiles.
+ *  - The decoded tiles, bounded by a share of the budget. A tile is decoded again from
+ *    its encoded data when its pixmap is removed.
+ *  When the budget is exceeded, the stalest tiles are removed. The staleness of a tile is
+ *  its number of uses of the cache since its last use plus a penalty per zoom level between
+ *  the tile and the actual zoom. The pixmaps are removed first, then the encoded data.
+ *  The number of hits and misses are counted to evaluate the efficiency of the budget.
+ */
+class CTileCache
+{
+public:
+  /*! Constructor.
+   *  \param maxCost: The budget in bytes. -1 (default) means 64Mbytes.
+   */
+  CTileCache (int maxCost = -1);
+
+  /*! Returns the budget in bytes. */
+  int maxCost () const { return m_maxCost; }
+
+  /*! Sets the budget in bytes. If the actual size exceeds the budget, tiles are removed. */
+  void setMaxCost (int maxCost);
+
+  /*! Returns the share in percent of the budget for decoded tiles. */
+  int decodedShare () const { return m_decodedShare; }
+
+  /*! Sets the share in percent of the budget for decoded tiles. Default 50. */
+  void setDecodedShare (int percent);
+
+  /*! Returns the size in bytes of all tiles (decoded and encoded). */
+  int totalCost () const { return static_cast<int>(m_decodedCost + m_encodedCost); }
+
+  /*! Returns the size in bytes of decoded tiles. */
+  int decodedCost () const { return static_cast<int>(m_decodedCost); }
+
+  /*! Returns the size in bytes of encoded tiles. */
+  int encodedCost () const { return static_cast<int>(m_encodedCost); }
+
+  /*! Returns the number of tiles. */
+  int count () const { return static_cast<int>(m_entries.size ()); }
+
+  /*! Returns the actual zoom used to compute the staleness of tiles. */
+  int zoom () const { return m_zoom; }
+
+  /*! Sets the actual zoom. The tiles far from this zoom are removed first. */
+  void setZoom (int zoom) { m_zoom = zoom; }
+
+  /*! Returns true if the decoded tile is in the cache. The hit and miss counters are not updated. */
+  bool contains (TTileKey key) const;
+
+  /*! Returns true if the encoded tile is in the cache. */
+  bool containsData (TTileKey key) const;
+
+  /*! Returns the decoded tile and marks it as the most recently used.
+   *  If the decoded tile is not in the cache a null pixmap is returned.
+   */
+  QPixmap pixmap (TTileKey key);
+
+  /*! Returns the encoded tile and marks it as the most recently used.
+   *  If the encoded tile is not in the cache an empty QByteArray is returned.
+   */
+  QByteArray data (TTileKey key);
+
+  /*! Inserts a decoded tile. The tile becomes the most recently used. */
+  void insert (TTileKey key, QPixmap const & pixmap);
+
+  /*! Inserts an encoded tile. The tile becomes the most recently used. */
+  void insertData (TTileKey key, QByteArray const & data);
+
+  /*! Removes a tile. */
+  void remove (TTileKey key);
+
+  /*! Removes all tiles. The counters are not reseted. */
+  void clear ();
+
+  /*! Removes the decoded tiles and keeps the encoded tiles, e.g. to decode them with a new style. */
+  void clearPixmaps ();
+
+  /*! Returns the number of tiles found in the cache. */
+  quint64 hits () const { return m_hits; }
+
+  /*! Returns the number of tiles not found in the cache. */
+  quint64 misses () const { return m_misses; }
+
+  /*! Resets hit and miss counters. */
+  void resetCounters () { m_hits = m_misses = 0; }
+
+  /*! Returns the size in bytes of a pixmap. */
+  static int cost (QPixmap const & pixmap);
+
+private:
+  /*! Entry of the cache. */
+  struct SEntry
+  {
+    QPixmap    m_pixmap;      //!< The decoded tile.
+    QByteArray m_data;        //!< The encoded tile.
+    quint64    m_lastUse = 0; //!< The value of m_clock at the last use.
+  };
+
+  SEntry& touch (TTileKey key);
+  qint64 decodedMaxCost () const { return static_cast<qint64>(m_maxCost) * m_decodedShare / 100; }
+  void evict ();
+
+private:
+  CFlatHash<SEntry> m_entries;           //!< The tiles.
+  qint64            m_decodedCost  = 0;  //!< Size of decoded tiles.
+  qint64            m_encodedCost  = 0;  //!< Size of encoded tiles.
+  int               m_maxCost;           //!< The budget.
+  int               m_decodedShare = 50; //!< Share of the budget for decoded tiles.
+  int               m_zoom         = 0;  //!< The actual zoom.
+  quint64           m_clock        = 0;  //!< Number of uses.
+  quint64           m_hits         = 0;  //!< Number of tiles found.
+  quint64           m_misses       = 0;  //!< Number of tiles not found.
+};
+
+#endif // TILECACHE_HPP
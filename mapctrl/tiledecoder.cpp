@@ -0,0 +1,136 @@
+﻿#include "tiledecoder.hpp"
+#include <QFile>
+
+// Size from which the tile files are mapped in place of being read.
+static qint64 const MapThreshold = 64 * 1024;
+
+CTileDecoder::CTileDecoder (int threadCount, QObject* parent) : QObject (parent)
+{
+#if QT_CONFIG(thread)
+  if (threadCount > 0)
+  {
+    m_pool.setMaxThreadCount (threadCount);
+  }
+#else
+  Q_UNUSED (threadCount)
+#endif
+}
+
+CTileDecoder::~CTileDecoder ()
+{
+  waitForDone ();
+}
+
+void CTileDecoder::waitForDone ()
+{
+#if QT_CONFIG(thread)
+  m_pool.clear ();
+  m_pool.waitForDone ();
+#endif
+}
+
+QSet<TTileKey> CTileDecoder::setVectorTileRenderer (TVectorTileRenderer const & renderer)
+{
+#if QT_CONFIG(thread)
+  m_pool.clear ();
+#endif
+  QSet<TTileKey> canceled;
+  canceled.swap (m_pending);
+  m_renderer = renderer;
+  ++m_generation;
+  return canceled;
+}
+
+QImage CTileDecoder::decodedImage (QByteArray const & data, QByteArray const & format,
+                                   CVectorTileRenderer const * renderer, int zoom)
+{
+  QImage image;
+  if (CVectorTileRenderer::isVectorFormat (format))
+  {
+    if (renderer != nullptr)
+    {
+      image = renderer->render (data, zoom);
+    }
+  }
+  else if (image.loadFromData (data, format.isEmpty () ? nullptr : format.constData ()) &&
+      image.format () != QImage::Format_ARGB32_Premultiplied)
+  {
+    image = image.convertToFormat (QImage::Format_ARGB32_Premultiplied);
+  }
+
+  return image;
+}
+
+void CTileDecoder::decode (TTileKey key, QByteArray const & data, QByteArray const & format)
+{
+  if (!m_pending.contains (key))
+  {
+    m_pending.insert (key);
+#if QT_CONFIG(thread)
+    int                 generation = m_generation;
+    TVectorTileRenderer renderer   = m_renderer;
+    m_pool.start ([this, key, data, format, renderer, generation] ()
+    {
+      // The decoder waits for the workers before its destruction, so this is valid here.
+      // The result is posted to the thread of the decoder.
+      QImage image = CTileDecoder::decodedImage (data, format, renderer.data (), tileKeyZ (key));
+      QMetaObject::invokeMethod (this, [this, key, image, generation] () { finished (key, image, generation); }, Qt::QueuedConnection);
+    });
+#else
+    finished (key, decodedImage (data, format, m_renderer.data (), tileKeyZ (key)), m_generation);
+#endif
+  }
+}
+
+QImage CTileDecoder::decodedFile (QString const & fileName, QByteArray const & format,
+                                  CVectorTileRenderer const * renderer, int zoom)
+{
+  QImage image;
+  QFile  file (fileName);
+  if (file.open (QIODevice::ReadOnly))
+  {
+    qint64 size = file.size ();
+    uchar* map  = size >= MapThreshold ? file.map (0, size) : nullptr;
+    if (map != nullptr)
+    { // The decoded image does not reference the data, the file can be unmapped after.
+      image = decodedImage (QByteArray::fromRawData (reinterpret_cast<char const *>(map), static_cast<int>(size)),
+                            format, renderer, zoom);
+      file.unmap (map);
+    }
+    else
+    {
+      image = decodedImage (file.readAll (), format, renderer, zoom);
+    }
+  }
+
+  return image;
+}
+
+void CTileDecoder::decodeFile (TTileKey key, QString const & fileName, QByteArray const & format, int priority)
+{
+  if (!m_pending.contains (key))
+  {
+    m_pending.insert (key);
+#if QT_CONFIG(thread)
+    int                 generation = m_generation;
+    TVectorTileRenderer renderer   = m_renderer;
+    m_pool.start ([this, key, fileName, format, renderer, generation] ()
+    {
+      QImage image = CTileDecoder::decodedFile (fileName, format, renderer.data (), tileKeyZ (key));
+      QMetaObject::invokeMethod (this, [this, key, image, generation] () { finished (key, image, generation); }, Qt::QueuedConnection);
+    }, priority);
+#else
+    Q_UNUSED (priority)
+    finished (key, decodedFile (fileName, format, m_renderer.data (), tileKeyZ (key)), m_generation);
+#endif
+  }
+}
+
+void CTileDecoder::finished (TTileKey key, QImage const & image, int generation)
+{
+  if (generation == m_generation)
+  { // Else drawn by a previous renderer.
+    m_pending.remove (key);
+    emit tileDecoded (key, image);
+  }
+}
@@ -0,0 +1,107 @@
+﻿#ifndef TILEDECODER_HPP
+#define TILEDECODER_HPP
+
+#include "tilekey.hpp"
+#include "vectortile.hpp"
+#include <QSharedPointer>
+#include <QImage>
+#include <QSet>
+#if QT_CONFIG(thread)
+#include <QThreadPool>
+#endif
+
+/*! \brief The CTileDecoder class decodes the tile images outside the GUI thread.
+ *
+ *  The encoded data (PNG, JPEG...) are decoded by a pool of worker threads in QImage
+ *  with the format QImage::Format_ARGB32_Premultiplied, the fastest format to draw.
+ *  The vector tiles (PBF, MVT) are drawn by the vector tile renderer.
+ *  When an image is decoded, the signal tileDecoded is emitted in the thread of the decoder.
+ *  Without thread support (e.g. web assembly), the images are decoded synchronously.
+ */
+class CTileDecoder : public QObject
+{
+  Q_OBJECT
+public:
+  using TVectorTileRenderer = QSharedPointer<CVectorTileRenderer const>;
+
+  /*! Constructor.
+   *  \param threadCount: The number of worker threads. -1 (default) means QThread::idealThreadCount.
+   *  \param parent: The QObject parent.
+   */
+  CTileDecoder (int threadCount = -1, QObject* parent = nullptr);
+
+  /*! Destructor. The pending decodings are canceled and the running decodings are waited. */
+  ~CTileDecoder () override;
+
+  /*! Starts the decoding of a tile.
+   *  \param key: The tile identifier.
+   *  \param data: The encoded image.
+   *  \param format: The image format (e.g. "PNG").
+   */
+  void decode (TTileKey key, QByteArray const & data, QByteArray const & format);
+
+  /*! Starts the reading and the decoding of a tile file.
+   *  The file is read by the worker, tileDecoded is emitted with a null image if the file does not exist.
+   *  \param key: The tile identifier.
+   *  \param fileName: The tile file.
+   *  \param format: The image format (e.g. "PNG").
+   *  \param priority: The priority in the queue of the workers, the highest first.
+   */
+  void decodeFile (TTileKey key, QString const & fileName, QByteArray const & format, int priority = 0);
+
+  /*! Cancels the pending decodings and waits for the running decodings.
+   *  Call it before releasing data passed to decode without copy (e.g. QByteArray::fromRawData).
+   */
+  void waitForDone ();
+
+  /*! Sets the renderer of the vector tiles.
+   *  The pending decodings are canceled and the images of the running decodings are ignored,
+   *  so no tile with the previous renderer is emitted.
+   *  \return The tiles whose decoding is canceled.
+   */
+  QSet<TTileKey> setVectorTileRenderer (TVectorTileRenderer const & renderer);
+
+  /*! Returns the renderer of the vector tiles. */
+  TVectorTileRenderer const & vectorTileRenderer () const { return m_renderer; }
+
+  /*! Returns true if the tile is waiting for decoding or is being decoded. */
+  bool isPending (TTileKey key) const { return m_pending.contains (key); }
+
+  /*! Returns the number of tiles waiting for decoding or being decoded. */
+  int pendingCount () const { return m_pending.size (); }
+
+  /*! Returns the decoded image. It is the function executed by the workers.
+   *  \param data: The encoded image.
+   *  \param format: The image format.
+   *  \param renderer: The renderer of the vector tiles. Without renderer, the vector tiles are not decoded.
+   *  \param zoom: The zoom of the tile used by the renderer.
+   */
+  static QImage decodedImage (QByteArray const & data, QByteArray const & format,
+                              CVectorTileRenderer const * renderer = nullptr, int zoom = 0);
+
+  /*! Returns the decoded image of a file. The large files are mapped, the others are read at once.
+   *  \param fileName: The tile file.
+   *  \param format: The image format.
+   *  \param renderer: The renderer of the vector tiles.
+   *  \param zoom: The zoom of the tile used by the renderer.
+   */
+  static QImage decodedFile (QString const & fileName, QByteArray const & format,
+                             CVectorTileRenderer const * renderer = nullptr, int zoom = 0);
+
+signals:
+  /*! The tile image is decoded. The image is null if the data are not valid. */
+  void tileDecoded (TTileKey key, QImage const & image);
+
+private:
+  void finished (TTileKey key, QImage const & image, int generation);
+
+private:
+  QSet<TTileKey>      m_pending;        //!< The tiles waiting for decoding.
+  TVectorTileRenderer m_renderer;       //!< The renderer of the vector tiles.
+  int                 m_generation = 0; //!< Incremented when the renderer changes.
+#if QT_CONFIG(thread)
+  QThreadPool         m_pool;           //!< The workers.
+#endif
+};
+
+#endif // TILEDECODER_HPP
@@ -0,0 +1,256 @@
+﻿#include "tilediskcache.hpp"
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDateTime>
+#include <QtEndian>
+#include <QVector>
+#include <QPair>
+#include <algorithm>
+#include <cstring>
+
+static char const    IndexMagic[4] = { 'T', 'M', 'D', 'C' };
+static quint32 const IndexVersion  = 1;
+static int const     HeaderSize    = 12;  // Magic, version, count.
+static int const     EntrySize     = 16;  // Key, size, last use.
+static int const     SaveInterval  = 256; // Number of changes between two saves of the index.
+
+static quint32 now ()
+{
+  return static_cast<quint32>(QDateTime::currentSecsSinceEpoch ());
+}
+
+CTileDiskCache::CTileDiskCache (QString const & directory, qint64 maxSize) :
+  m_directory (directory), m_maxSize (maxSize < 0 ? Q_INT64_C (100) * 1024 * 1024 : maxSize)
+{
+  QDir ().mkpath (m_directory);
+  if (!loadIndex ())
+  {
+    rebuildIndex ();
+  }
+
+  evict ();
+}
+
+CTileDiskCache::~CTileDiskCache ()
+{
+  if (m_unsaved != 0)
+  {
+    saveIndex ();
+  }
+}
+
+QString CTileDiskCache::fileName (TTileKey key) const
+{
+  return QStringLiteral ("%1/%2/%3/%4/%5.tile").arg (m_directory).arg (tileKeyIndex (key))
+                                                .arg (tileKeyZ (key)).arg (tileKeyX (key)).arg (tileKeyY (key));
+}
+
+void CTileDiskCache::setMaxSize (qint64 maxSize)
+{
+  m_maxSize = maxSize;
+  evict ();
+}
+
+QByteArray CTileDiskCache::data (TTileKey key)
+{
+  QByteArray data;
+  SEntry*    entry = m_entries.find (key);
+  if (entry != nullptr)
+  {
+    QFile file (fileName (key));
+    if (file.open (QIODevice::ReadOnly))
+    {
+      data             = file.readAll ();
+      entry->m_lastUse = now ();
+      ++m_unsaved;
+    }
+    else
+    { // Removed by someone else.
+      m_size -= entry->m_size;
+      m_entries.remove (key);
+      ++m_unsaved;
+    }
+  }
+
+  return data;
+}
+
+bool CTileDiskCache::insert (TTileKey key, QByteArray const & data)
+{
+  QString name = fileName (key);
+  QFile   file (name);
+  if (!file.open (QIODevice::WriteOnly))
+  {
+    // The first tile of a column creates the folder.
+    QDir ().mkpath (QFileInfo (name).path ());
+    if (!file.open (QIODevice::WriteOnly))
+    {
+      return false;
+    }
+  }
+
+  if (file.write (data) != data.size ())
+  {
+    file.close ();
+    file.remove ();
+    remove (key);
+    return false;
+  }
+
+  SEntry& entry   = m_entries[key];
+  m_size         += data.size () - static_cast<qint64>(entry.m_size);
+  entry.m_size    = static_cast<quint32>(data.size ());
+  entry.m_lastUse = now ();
+  evict ();
+  if (++m_unsaved >= SaveInterval)
+  {
+    saveIndex ();
+  }
+
+  return true;
+}
+
+void CTileDiskCache::remove (TTileKey key)
+{
+  SEntry const * entry = m_entries.find (key);
+  if (entry != nullptr)
+  {
+    m_size -= entry->m_size;
+    m_entries.remove (key);
+    QFile::remove (fileName (key));
+    ++m_unsaved;
+  }
+}
+
+void CTileDiskCache::clear ()
+{
+  QDir folder (m_directory);
+  folder.removeRecursively ();
+  QDir ().mkpath (m_directory);
+  m_entries.clear ();
+  m_size    = 0;
+  m_unsaved = 0;
+}
+
+void CTileDiskCache::evict ()
+{
+  if (m_size > m_maxSize)
+  {
+    // Remove the least recently used tiles up to 90% of the budget to not evict at each insert.
+    QVector<QPair<quint32, TTileKey>> uses;
+    uses.reserve (static_cast<int>(m_entries.size ()));
+    m_entries.forEach ([&uses] (TTileKey key, SEntry const & entry) { uses.append (qMakePair (entry.m_lastUse, key)); });
+    std::sort (uses.begin (), uses.end ());
+
+    qint64 target = m_maxSize - m_maxSize / 10;
+    for (QPair<quint32, TTileKey> const & use : qAsConst (uses))
+    {
+      if (m_size <= target)
+      {
+        break;
+      }
+
+      remove (use.second);
+    }
+  }
+}
+
+bool CTileDiskCache::loadIndex ()
+{
+  QFile file (m_directory + QLatin1String ("/index"));
+  if (!file.open (QIODevice::ReadOnly))
+  {
+    return false;
+  }
+
+  QByteArray    index = file.readAll ();
+  uchar const * data  = reinterpret_cast<uchar const *>(index.constData ());
+  if (index.size () < HeaderSize || std::memcmp (data, IndexMagic, sizeof (IndexMagic)) != 0 ||
+      qFromLittleEndian<quint32> (data + 4) != IndexVersion)
+  {
+    return false;
+  }
+
+  quint32 count = qFromLittleEndian<quint32> (data + 8);
+  if (index.size () != HeaderSize + static_cast<qint64>(count) * EntrySize)
+  {
+    return false;
+  }
+
+  m_entries.clear ();
+  m_entries.reserve (count);
+  m_size = 0;
+  for (quint32 i = 0; i < count; ++i)
+  {
+    uchar const * e = data + HeaderSize + static_cast<qint64>(i) * EntrySize;
+    SEntry        entry;
+    entry.m_size    = qFromLittleEndian<quint32> (e + 8);
+    entry.m_lastUse = qFromLittleEndian<quint32> (e + 12);
+    m_entries.insert (qFromLittleEndian<quint64> (e), entry);
+    m_size         += entry.m_size;
+  }
+
+  m_unsaved = 0;
+  return true;
+}
+
+void CTileDiskCache::rebuildIndex ()
+{
+  m_entries.clear ();
+  m_size = 0;
+
+  // <directory>/<url index>/<z>/<x>/<y>.tile
+  QDirIterator it (m_directory, QStringList (QStringLiteral ("*.tile")), QDir::Files, QDirIterator::Subdirectories);
+  while (it.hasNext ())
+  {
+    it.next ();
+    QFileInfo   info  = it.fileInfo ();
+    QStringList parts = QDir (m_directory).relativeFilePath (info.filePath ()).split ('/');
+    if (parts.size () == 4)
+    {
+      bool ok[4];
+      int  index = parts[0].toInt (&ok[0]);
+      int  z     = parts[1].toInt (&ok[1]);
+      int  x     = parts[2].toInt (&ok[2]);
+      int  y     = info.completeBaseName ().toInt (&ok[3]);
+      if (ok[0] && ok[1] && ok[2] && ok[3])
+      {
+        SEntry entry;
+        entry.m_size    = static_cast<quint32>(info.size ());
+        entry.m_lastUse = static_cast<quint32>(info.lastModified ().toSecsSinceEpoch ());
+        m_entries.insert (tileKey (x, y, z, index), entry);
+        m_size         += entry.m_size;
+      }
+    }
+  }
+
+  m_unsaved = 1; // Save the rebuilt index.
+}
+
+bool CTileDiskCache::saveIndex ()
+{
+  QByteArray index (HeaderSize + static_cast<int>(m_entries.size ()) * EntrySize, '\0');
+  uchar*     data = reinterpret_cast<uchar*>(index.data ());
+  std::memcpy (data, IndexMagic, sizeof (IndexMagic));
+  qToLittleEndian<quint32> (IndexVersion, data + 4);
+  qToLittleEndian<quint32> (static_cast<quint32>(m_entries.size ()), data + 8);
+  uchar* e = data + HeaderSize;
+  m_entries.forEach ([&e] (TTileKey key, SEntry const & entry)
+  {
+    qToLittleEndian<quint64> (key, e);
+    qToLittleEndian<quint32> (entry.m_size, e + 8);
+    qToLittleEndian<quint32> (entry.m_lastUse, e + 12);
+    e += EntrySize;
+  });
+
+  QSaveFile file (m_directory + QLatin1String ("/index"));
+  bool      ok = file.open (QIODevice::WriteOnly) && file.write (index) == index.size () && file.commit ();
+  if (ok)
+  {
+    m_unsaved = 0;
+  }
+
+  return ok;
+}
@@ -0,0 +1,93 @@
+﻿#ifndef TILEDISKCACHE_HPP
+#define TILEDISKCACHE_HPP
+
+#include "tilekey.hpp"
+#include "../tools/flathash.hpp"
+#include <QString>
+#include <QByteArray>
+
+/*! \brief The CTileDiskCache class is a persistent disk cache of encoded tiles.
+ *
+ *  Unlike the QNetworkDiskCache used by default, the tiles are kept when the tile adapter
+ *  is destroyed and are reused at the next start.
+ *  Each tile is stored as is in the file <directory>/<url index>/<z>/<x>/<y>.tile.
+ *  The index (size and last use of the tiles) is saved in <directory>/index and loaded by
+ *  the constructor. If the index is missing or invalid, it is rebuilt from the files.
+ *  When the size of the tiles exceeds the budget, the least recently used tiles are removed
+ *  until the size is under 90% of the budget.
+ *  The tiles do not expire. They are only removed by the budget.
+ */
+class CTileDiskCache
+{
+public:
+  /*! Constructor. The index is loaded.
+   *  \param directory: The cache directory. It is created if it does not exist.
+   *  \param maxSize: The budget in bytes. -1 (default) means 100Mbytes.
+   */
+  CTileDiskCache (QString const & directory, qint64 maxSize = -1);
+
+  /*! Destructor. The index is saved. The tiles are kept. */
+  ~CTileDiskCache ();
+
+  CTileDiskCache (CTileDiskCache const &) = delete;
+  CTileDiskCache& operator = (CTileDiskCache const &) = delete;
+
+  /*! Returns the cache directory. */
+  QString const & directory () const { return m_directory; }
+
+  /*! Returns the budget in bytes. */
+  qint64 maxSize () const { return m_maxSize; }
+
+  /*! Sets the budget in bytes. If the actual size exceeds the budget, tiles are removed. */
+  void setMaxSize (qint64 maxSize);
+
+  /*! Returns the size in bytes of all tiles. */
+  qint64 size () const { return m_size; }
+
+  /*! Returns the number of tiles. */
+  int count () const { return static_cast<int>(m_entries.size ()); }
+
+  /*! Returns true if the tile is in the cache. */
+  bool contains (TTileKey key) const { return m_entries.contains (key); }
+
+  /*! Returns the data of the tile and marks it as the most recently used.
+   *  An empty QByteArray is returned if the tile is not in the cache.
+   */
+  QByteArray data (TTileKey key);
+
+  /*! Stores the data of the tile. Returns false if the file cannot be written. */
+  bool insert (TTileKey key, QByteArray const & data);
+
+  /*! Removes the tile. */
+  void remove (TTileKey key);
+
+  /*! Removes all tiles. */
+  void clear ();
+
+  /*! Saves the index. It is done by the destructor and regularly by insert. */
+  bool saveIndex ();
+
+  /*! Returns the file of the tile. */
+  QString fileName (TTileKey key) const;
+
+private:
+  bool loadIndex ();
+  void rebuildIndex ();
+  void evict ();
+
+private:
+  /*! Entry of the index. */
+  struct SEntry
+  {
+    quint32 m_size    = 0; //!< The size of the file.
+    quint32 m_lastUse = 0; //!< The time of the last use in seconds since epoch.
+  };
+
+  QString           m_directory;    //!< The cache directory.
+  CFlatHash<SEntry> m_entries;      //!< The index.
+  qint64            m_size     = 0; //!< The size of all tiles.
+  qint64            m_maxSize;      //!< The budget.
+  int               m_unsaved  = 0; //!< The number of changes since the last save of the index.
+};
+
+#endif // TILEDISKCACHE_HPP
@@ -0,0 +1,46 @@
+﻿#ifndef TILEKEY_HPP
+#define TILEKEY_HPP
+
+#include <QtGlobal>
+
+/*! The tile identifier. x, y, z and the url index are packed in a 64 bits integer.
+ *  - bits  0-23: y
+ *  - bits 24-47: x
+ *  - bits 48-55: z
+ *  - bits 56-63: url index
+ *  24 bits for x and y allow zoom levels up to 24.
+ */
+using TTileKey = quint64;
+
+/*! Returns the tile identifier from the tile coordinates and the url index. */
+inline TTileKey tileKey (int x, int y, int z, int index)
+{
+  return (static_cast<TTileKey>(index & 0xFF) << 56) | (static_cast<TTileKey>(z & 0xFF) << 48) |
+         (static_cast<TTileKey>(x & 0xFFFFFF) << 24) | static_cast<TTileKey>(y & 0xFFFFFF);
+}
+
+/*! Returns x of the tile identifier. */
+inline int tileKeyX (TTileKey key)
+{
+  return static_cast<int>((key >> 24) & 0xFFFFFF);
+}
+
+/*! Returns y of the tile identifier. */
+inline int tileKeyY (TTileKey key)
+{
+  return static_cast<int>(key & 0xFFFFFF);
+}
+
+/*! Returns z of the tile identifier. */
+inline int tileKeyZ (TTileKey key)
+{
+  return static_cast<int>((key >> 48) & 0xFF);
+}
+
+/*! Returns the url index of the tile identifier. */
+inline int tileKeyIndex (TTileKey key)
+{
+  return static_cast<int>((key >> 56) & 0xFF);
+}
+
+#endif // TILEKEY_HPP
@@ -0,0 +1,261 @@
+﻿#include "tilepack.hpp"
+#include <QNetworkDiskCache>
+#include <QRegularExpression>
+#include <QDirIterator>
+#include <QSaveFile>
+#include <QtEndian>
+#include <algorithm>
+#include <limits>
+#include <cstring>
+
+static char const Magic[4] = { 'T', 'M', 'T', 'P' };
+
+bool CTilePack::open (QString const & fileName)
+{
+  close ();
+  m_file.setFileName (fileName);
+  if (!m_file.open (QIODevice::ReadOnly))
+  {
+    m_message = m_file.errorString ();
+    return false;
+  }
+
+  m_size = m_file.size ();
+  if (m_size < HeaderSize)
+  {
+    m_message = QStringLiteral ("Not a tile pack: ") + fileName;
+    close ();
+    return false;
+  }
+
+  uchar const * data = m_file.map (0, m_size);
+  if (data == nullptr)
+  {
+    m_buffer = m_file.readAll ();
+    data     = reinterpret_cast<uchar const *>(m_buffer.constData ());
+  }
+
+  m_data            = data;
+  quint16 version   = qFromLittleEndian<quint16> (m_data + 4);
+  m_tileSize        = qFromLittleEndian<quint16> (m_data + 6);
+  m_zoomMin         = m_data[8];
+  m_zoomMax         = m_data[9];
+  m_count           = qFromLittleEndian<quint32> (m_data + 12);
+  char const * fmt  = reinterpret_cast<char const *>(m_data + 16);
+  m_format          = QByteArray (fmt, static_cast<int>(qstrnlen (fmt, 8)));
+  if (std::memcmp (m_data, Magic, sizeof (Magic)) != 0 || version > Version ||
+      HeaderSize + static_cast<qint64>(m_count) * EntrySize > m_size)
+  {
+    m_message = QStringLiteral ("Not a tile pack: ") + fileName;
+    close ();
+    return false;
+  }
+
+  return true;
+}
+
+void CTilePack::close ()
+{
+  if (m_data != nullptr && m_buffer.isEmpty ())
+  {
+    m_file.unmap (const_cast<uchar*>(m_data));
+  }
+
+  m_data  = nullptr;
+  m_size  = 0;
+  m_count = 0;
+  m_buffer.clear ();
+  m_file.close ();
+}
+
+uchar const * CTilePack::entry (int x, int y, int z) const
+{
+  // Binary search in the index sorted by key.
+  TTileKey      key   = tileKey (x, y, z, 0);
+  uchar const * index = m_data + HeaderSize;
+  quint32       first = 0;
+  quint32       last  = m_count;
+  while (first < last)
+  {
+    quint32       middle = first + (last - first) / 2;
+    uchar const * entry  = index + static_cast<qint64>(middle) * EntrySize;
+    TTileKey      k      = qFromLittleEndian<quint64> (entry);
+    if (k < key)
+    {
+      first = middle + 1;
+    }
+    else if (k > key)
+    {
+      last = middle;
+    }
+    else
+    {
+      return entry;
+    }
+  }
+
+  return nullptr;
+}
+
+QByteArray CTilePack::data (int x, int y, int z) const
+{
+  QByteArray    data;
+  uchar const * entry = isOpen () ? this->entry (x, y, z) : nullptr;
+  if (entry != nullptr)
+  {
+    quint64 offset = qFromLittleEndian<quint64> (entry + 8);
+    quint32 size   = qFromLittleEndian<quint32> (entry + 16);
+    if (size <= static_cast<quint64>(m_size) && offset <= static_cast<quint64>(m_size) - size)
+    {
+      data = QByteArray::fromRawData (reinterpret_cast<char const *>(m_data + offset), static_cast<int>(size));
+    }
+  }
+
+  return data;
+}
+
+CTilePackWriter::CTilePackWriter (QByteArray const & format, int tileSize) : m_format (format), m_tileSize (tileSize)
+{
+}
+
+int CTilePackWriter::addCacheDirectory (QString const & cacheDirectory, QString const & urlFormat, bool swapCoordinates)
+{
+  // The url format becomes a regular expression capturing z, x and y.
+  QString pattern = QRegularExpression::escape (urlFormat);
+  pattern.replace (QLatin1String ("\\%1"), QLatin1String ("(\\d+)"));
+  pattern.replace (QLatin1String ("\\%2"), QLatin1String ("(\\d+)"));
+  pattern.replace (QLatin1String ("\\%3"), QLatin1String ("(\\d+)"));
+  pattern.replace (QLatin1String ("\\%4"), QLatin1String (".*"));
+  QRegularExpression regExp (QRegularExpression::anchoredPattern (pattern));
+
+  QNetworkDiskCache cache;
+  cache.setCacheDirectory (cacheDirectory);
+
+  int          count = 0;
+  QDirIterator it (cacheDirectory, QStringList (QStringLiteral ("*.d")), QDir::Files, QDirIterator::Subdirectories);
+  while (it.hasNext ())
+  {
+    QString                 url   = cache.fileMetaData (it.next ()).url ().toString ();
+    QRegularExpressionMatch match = regExp.match (url);
+    if (match.hasMatch ())
+    {
+      int z = match.captured (1).toInt ();
+      int x = match.captured (2).toInt ();
+      int y = match.captured (3).toInt ();
+      if (swapCoordinates)
+      {
+        std::swap (x, y);
+      }
+
+      STile tile;
+      tile.m_key       = tileKey (x, y, z, 0);
+      tile.m_directory = cacheDirectory;
+      tile.m_url       = url;
+      m_tiles.append (tile);
+      ++count;
+    }
+  }
+
+  return count;
+}
+
+void CTilePackWriter::addFile (TTileKey key, QString const & fileName)
+{
+  STile tile;
+  tile.m_key      = tileKey (tileKeyX (key), tileKeyY (key), tileKeyZ (key), 0);
+  tile.m_fileName = fileName;
+  m_tiles.append (tile);
+}
+
+bool CTilePackWriter::write (QString const & fileName)
+{
+  // Sorted index without duplicates.
+  std::stable_sort (m_tiles.begin (), m_tiles.end (), [] (STile const & t1, STile const & t2) { return t1.m_key < t2.m_key; });
+  m_tiles.erase (std::unique (m_tiles.begin (), m_tiles.end (), [] (STile const & t1, STile const & t2) { return t1.m_key == t2.m_key; }),
+                 m_tiles.end ());
+
+  QSaveFile file (fileName);
+  if (!file.open (QIODevice::WriteOnly))
+  {
+    m_message = file.errorString ();
+    return false;
+  }
+
+  // The tiles are written after the header and the index. The header and the index are written at the end.
+  int        count  = m_tiles.size ();
+  qint64     offset = CTilePack::HeaderSize + static_cast<qint64>(count) * CTilePack::EntrySize;
+  QByteArray index (count * CTilePack::EntrySize, '\0');
+  file.seek (offset);
+
+  QNetworkDiskCache cache;
+  cache.setMaximumCacheSize (std::numeric_limits<qint64>::max ()); // Nothing is removed.
+  int zoomMin = 255, zoomMax = 0;
+  for (int i = 0; i < count; ++i)
+  {
+    // A tile removed from the cache since it has been added has an empty entry (size 0).
+    STile const & tile = m_tiles[i];
+    QByteArray    data;
+    if (!tile.m_fileName.isEmpty ())
+    {
+      QFile tileFile (tile.m_fileName);
+      if (tileFile.open (QIODevice::ReadOnly))
+      {
+        data = tileFile.readAll ();
+      }
+    }
+    else
+    {
+      if (cache.cacheDirectory () != tile.m_directory)
+      {
+        cache.setCacheDirectory (tile.m_directory);
+      }
+
+      QIODevice* device = cache.data (QUrl (tile.m_url));
+      if (device != nullptr)
+      {
+        if (device->open (QIODevice::ReadOnly))
+        {
+          data = device->readAll ();
+        }
+
+        delete device;
+      }
+    }
+
+    if (file.write (data) != data.size ())
+    {
+      m_message = file.errorString ();
+      file.cancelWriting ();
+      return false;
+    }
+
+    uchar* entry = reinterpret_cast<uchar*>(index.data ()) + i * CTilePack::EntrySize;
+    qToLittleEndian<quint64> (tile.m_key, entry);
+    qToLittleEndian<quint64> (static_cast<quint64>(offset), entry + 8);
+    qToLittleEndian<quint32> (static_cast<quint32>(data.size ()), entry + 16);
+    offset += data.size ();
+
+    int z   = tileKeyZ (tile.m_key);
+    zoomMin = std::min (zoomMin, z);
+    zoomMax = std::max (zoomMax, z);
+  }
+
+  QByteArray header (CTilePack::HeaderSize, '\0');
+  uchar*     h = reinterpret_cast<uchar*>(header.data ());
+  std::memcpy (h, Magic, sizeof (Magic));
+  qToLittleEndian<quint16> (CTilePack::Version, h + 4);
+  qToLittleEndian<quint16> (static_cast<quint16>(m_tileSize), h + 6);
+  h[8] = static_cast<uchar>(count != 0 ? zoomMin : 0);
+  h[9] = static_cast<uchar>(zoomMax);
+  qToLittleEndian<quint32> (static_cast<quint32>(count), h + 12);
+  std::memcpy (h + 16, m_format.constData (), static_cast<size_t>(std::min (m_format.size (), 8)));
+
+  file.seek (0);
+  if (file.write (header) != header.size () || file.write (index) != index.size () || !file.commit ())
+  {
+    m_message = file.errorString ();
+    return false;
+  }
+
+  return true;
+}
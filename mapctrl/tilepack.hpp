@@ -0,0 +1,146 @@
+﻿#ifndef TILEPACK_HPP
+#define TILEPACK_HPP
+
+#include "tilekey.hpp"
+#include <QFile>
+#include <QVector>
+
+/*! \brief The CTilePack class reads a tile pack, a read-only file of encoded tiles.
+ *
+ *  All numbers are little endian. The file contains:
+ *  - The header (32 bytes): "TMTP", version (16 bits), tile size (16 bits), zoom min (8 bits),
+ *    zoom max (8 bits), reserved (16 bits), tile count (32 bits), image format (8 chars), reserved (64 bits).
+ *  - The index: one entry (24 bytes) per tile sorted by key: key (64 bits, see tileKey with url index 0),
+ *    offset of data from the start of the file (64 bits), size of data (32 bits), reserved (32 bits).
+ *  - The encoded tiles (PNG, JPEG...) concatenated.
+ *
+ *  The file is mapped in memory. A tile is found by a binary search in the index and the data
+ *  is returned without copy. If the file cannot be mapped (e.g. web assembly), it is read in memory.
+ */
+class CTilePack
+{
+public:
+  /*! Size in bytes of the header. */
+  static int const HeaderSize = 32;
+
+  /*! Size in bytes of an index entry. */
+  static int const EntrySize = 24;
+
+  /*! Version written in the header. */
+  static quint16 const Version = 1;
+
+  /*! Constructor. */
+  CTilePack () = default;
+
+  /*! Destructor. The file is unmapped. */
+  ~CTilePack () { close (); }
+
+  CTilePack (CTilePack const &) = delete;
+  CTilePack& operator = (CTilePack const &) = delete;
+
+  /*! Opens the file. On error, returns false and errorString returns the message. */
+  bool open (QString const & fileName);
+
+  /*! Closes the file. The QByteArray returned by data become invalid. */
+  void close ();
+
+  /*! Returns true if a file is opened. */
+  bool isOpen () const { return m_data != nullptr; }
+
+  /*! Returns the last error message. */
+  QString const & errorString () const { return m_message; }
+
+  /*! Returns the number of tiles. */
+  int count () const { return static_cast<int>(m_count); }
+
+  /*! Returns the image format of the tiles (e.g. "PNG"). */
+  QByteArray const & format () const { return m_format; }
+
+  /*! Returns the size of the tiles in pixels. */
+  int tileSize () const { return m_tileSize; }
+
+  /*! Returns the min of zoom. */
+  int zoomMin () const { return m_zoomMin; }
+
+  /*! Returns the max of zoom. */
+  int zoomMax () const { return m_zoomMax; }
+
+  /*! Returns true if the pack contains the tile. */
+  bool contains (int x, int y, int z) const { return entry (x, y, z) != nullptr; }
+
+  /*! Returns the encoded data of the tile or an empty QByteArray if the tile is not in the pack.
+   *  The data is not copied. It is valid until the file is closed.
+   */
+  QByteArray data (int x, int y, int z) const;
+
+private:
+  uchar const * entry (int x, int y, int z) const;
+
+private:
+  QFile         m_file;                //!< The pack file.
+  QByteArray    m_buffer;              //!< The file content if the file cannot be mapped.
+  uchar const * m_data      = nullptr; //!< The file content.
+  qint64        m_size      = 0;       //!< The size of the file.
+  quint32       m_count     = 0;       //!< The number of tiles.
+  QByteArray    m_format;              //!< The image format.
+  int           m_tileSize  = 256;     //!< The size of the tiles.
+  int           m_zoomMin   = 0;       //!< The min of zoom.
+  int           m_zoomMax   = 0;       //!< The max of zoom.
+  QString       m_message;             //!< The last error message.
+};
+
+/*! \brief The CTilePackWriter class builds a tile pack (see CTilePack).
+ *
+ *  The tiles are collected from the disk cache directory of a tile adapter or from files, then the pack is written.
+ *  Only the index is kept in memory, the tiles are copied one by one.
+ */
+class CTilePackWriter
+{
+public:
+  /*! Constructor.
+   *  \param format: The image format of the tiles (e.g. "PNG").
+   *  \param tileSize: The size of the tiles in pixels.
+   */
+  CTilePackWriter (QByteArray const & format = "PNG", int tileSize = 256);
+
+  /*! Collects the tiles stored in the QNetworkDiskCache directory.
+   *  \param cacheDirectory: The cache directory (e.g. <CacheLocation>/tiles/osm).
+   *  \param urlFormat: The url format of the tiles (see CTileAdapter::urls).
+   *                    The cached urls not matching the format are ignored.
+   *  \param swapCoordinates: true for url format with %2=y, %3=x (Esri).
+   *  \return The number of collected tiles.
+   */
+  int addCacheDirectory (QString const & cacheDirectory, QString const & urlFormat, bool swapCoordinates = false);
+
+  /*! Adds a tile stored in a file (e.g. see CTileDiskCache::fileName).
+   *  \param key: The tile identifier. The url index is ignored.
+   *  \param fileName: The file containing the encoded tile.
+   */
+  void addFile (TTileKey key, QString const & fileName);
+
+  /*! Returns the number of collected tiles. */
+  int count () const { return m_tiles.size (); }
+
+  /*! Writes the pack. On error, returns false and errorString returns the message. */
+  bool write (QString const & fileName);
+
+  /*! Returns the last error message. */
+  QString const & errorString () const { return m_message; }
+
+private:
+  /*! Tile collected from a cache directory or a file. */
+  struct STile
+  {
+    TTileKey m_key;       //!< The tile identifier with url index 0.
+    QString  m_directory; //!< The cache directory.
+    QString  m_url;       //!< The url in the cache.
+    QString  m_fileName;  //!< The file of the tile if it is not in a cache directory.
+  };
+
+  QVector<STile> m_tiles;    //!< Collected tiles.
+  QByteArray     m_format;   //!< The image format.
+  int            m_tileSize; //!< The size of the tiles.
+  QString        m_message;  //!< The last error message.
+};
+
+#endif // TILEPACK_HPP
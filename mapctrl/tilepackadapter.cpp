@@ -0,0 +1,44 @@
+﻿#include "tilepackadapter.hpp"
+
+CTilePackAdapter::CTilePackAdapter (QString const & fileName) :
+  CTileAdapter (QStringList (), "tilepack", 256, 0, 19, false, NoDiskCache)
+{
+  m_keepEncoded = false; // The mapped file is already in memory.
+  if (m_pack.open (fileName))
+  {
+    m_tileSize    = m_pack.tileSize ();
+    m_zoomMin     = m_pack.zoomMin ();
+    m_zoomMax     = m_pack.zoomMax ();
+    m_imageFormat = m_pack.format ();
+    setVectorTileStyle (vectorTileStyle ()); // Vector tiles drawn at the tile size of the pack.
+  }
+  else
+  {
+    m_message = m_pack.errorString ();
+  }
+}
+
+CTilePackAdapter::~CTilePackAdapter ()
+{
+  // The decoder of the base class is destroyed after the pack.
+  m_decoder.waitForDone ();
+}
+
+void CTilePackAdapter::requestTile (TTileKey key, CTileScheduler::EPriority priority)
+{
+  Q_UNUSED (priority)
+  QByteArray data = cachedData (key);
+  if (!data.isEmpty ())
+  {
+    tileLoaded (key, data);
+  }
+  else
+  {
+    tileMissing (key);
+  }
+}
+
+QByteArray CTilePackAdapter::cachedData (TTileKey key)
+{
+  return m_pack.data (tileKeyX (key), tileKeyY (key), tileKeyZ (key));
+}
@@ -0,0 +1,42 @@
+﻿#ifndef TILEPACKADAPTER_HPP
+#define TILEPACKADAPTER_HPP
+
+#include "tileadapter.hpp"
+#include "tilepack.hpp"
+
+/*! \brief The CTilePackAdapter class used to read tiles from a tile pack (see CTilePack).
+ *
+ *  No network request is sent and no disk cache is created. A requested tile is found by a
+ *  binary search in the mapped index and its data is sent to the decoder without copy.
+ */
+class CTilePackAdapter : public CTileAdapter
+{
+  Q_OBJECT
+public:
+  /*! Constructor.
+   *  The tile size, the zoom range and the image format are read from the pack header.
+   *  \param fileName: The tile pack file.
+   */
+  CTilePackAdapter (QString const & fileName);
+
+  /*! Destructor. The decodings using the mapped data are finished before the file is closed. */
+  ~CTilePackAdapter () override;
+
+  /*! Returns true if the file is opened. On error, use errorString to get the message. */
+  bool isOpen () const { return m_pack.isOpen (); }
+
+  /*! Returns the last error message. */
+  QString const & errorString () const { return m_message; }
+
+  /*! Returns the tile pack as a const reference. */
+  CTilePack const & pack () const { return m_pack; }
+
+protected:
+  void requestTile (TTileKey key, CTileScheduler::EPriority priority) override;
+  QByteArray cachedData (TTileKey key) override;
+
+private:
+  CTilePack m_pack; //!< The mapped file.
+};
+
+#endif // TILEPACKADAPTER_HPP
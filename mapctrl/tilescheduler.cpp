@@ -0,0 +1,194 @@
+﻿#include "tilescheduler.hpp"
+#include <cmath>
+
+CTileScheduler::CTileScheduler (QObject* parent) : QObject (parent)
+{
+  m_bucketTimer.setSingleShot (true);
+  connect (&m_bucketTimer, &QTimer::timeout, this, &CTileScheduler::dispatch);
+  m_bucketClock.start ();
+}
+
+void CTileScheduler::setRateLimit (qreal requestsPerSecond, int burst)
+{
+  m_rate   = std::max (static_cast<qreal>(0), requestsPerSecond);
+  m_burst  = std::max (1, burst);
+  m_tokens = m_burst;
+  m_bucketClock.restart ();
+}
+
+void CTileScheduler::setCenter (int z, QPointF const & center)
+{
+  if (z != m_centerZ || center != m_center)
+  {
+    m_centerZ = z;
+    m_center  = center;
+    m_sorted  = false;
+  }
+}
+
+void CTileScheduler::enqueue (TTileKey key, QString const & host, EPriority priority)
+{
+  if (promote (key, priority))
+  {
+    return;
+  }
+
+  SRequest request;
+  request.m_key       = key;
+  request.m_host      = host;
+  request.m_priority  = priority;
+  request.m_distance2 = 0;
+  m_queue.append (request);
+  m_sorted = false;
+  scheduleDispatch ();
+}
+
+bool CTileScheduler::promote (TTileKey key, EPriority priority)
+{
+  for (SRequest& request : m_queue)
+  {
+    if (request.m_key == key)
+    {
+      if (priority < request.m_priority)
+      {
+        request.m_priority = priority;
+        m_sorted           = false;
+        scheduleDispatch ();
+      }
+
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void CTileScheduler::finished (QString const & host)
+{
+  QHash<QString, int>::iterator it = m_active.find (host);
+  if (it != m_active.end () && --it.value () <= 0)
+  {
+    m_active.erase (it);
+  }
+
+  scheduleDispatch ();
+}
+
+QVector<TTileKey> CTileScheduler::removeIf (std::function<bool (TTileKey)> const & predicate)
+{
+  QVector<TTileKey> keys;
+  QVector<SRequest> queue;
+  queue.reserve (m_queue.size ());
+  for (SRequest const & request : qAsConst (m_queue))
+  {
+    if (predicate (request.m_key))
+    {
+      keys.append (request.m_key);
+    }
+    else
+    {
+      queue.append (request);
+    }
+  }
+
+  if (!keys.isEmpty ())
+  {
+    m_queue.swap (queue);
+  }
+
+  return keys;
+}
+
+int CTileScheduler::activeCount () const
+{
+  int count = 0;
+  for (int active : m_active)
+  {
+    count += active;
+  }
+
+  return count;
+}
+
+void CTileScheduler::scheduleDispatch ()
+{
+  // Dispatch when the event loop is reached, all the tiles of a paint are then queued and sorted.
+  if (!m_dispatchPending)
+  {
+    m_dispatchPending = true;
+    QMetaObject::invokeMethod (this, "dispatch", Qt::QueuedConnection);
+  }
+}
+
+void CTileScheduler::sort ()
+{
+  for (SRequest& request : m_queue)
+  {
+    // Center at the zoom of the tile.
+    int     dz     = tileKeyZ (request.m_key) - m_centerZ;
+    qreal   scale  = std::ldexp (static_cast<qreal>(1), dz);
+    QPointF center = m_center * scale;
+    qreal   dx     = tileKeyX (request.m_key) + 0.5 - center.x ();
+    qreal   dy     = tileKeyY (request.m_key) + 0.5 - center.y ();
+    request.m_distance2 = static_cast<float>(dx * dx + dy * dy);
+  }
+
+  // The best request is at the end of the queue.
+  std::sort (m_queue.begin (), m_queue.end (), [] (SRequest const & r1, SRequest const & r2) -> bool
+  {
+    return r1.m_priority != r2.m_priority ? r1.m_priority > r2.m_priority : r1.m_distance2 > r2.m_distance2;
+  });
+
+  m_sorted = true;
+}
+
+bool CTileScheduler::hasToken ()
+{
+  bool has = true;
+  if (m_rate > 0)
+  {
+    qint64 elapsed = m_bucketClock.restart ();
+    m_tokens       = std::min (m_burst, m_tokens + elapsed * m_rate / 1000);
+    has            = m_tokens >= 1;
+    if (!has && !m_bucketTimer.isActive ())
+    {
+      m_bucketTimer.start (static_cast<int>(std::ceil ((1 - m_tokens) * 1000 / m_rate)));
+    }
+  }
+
+  return has;
+}
+
+void CTileScheduler::dispatch ()
+{
+  m_dispatchPending = false;
+  if (!m_sorted)
+  {
+    sort ();
+  }
+
+  while (!m_queue.isEmpty () && hasToken ())
+  {
+    // The best request whose host accepts a new connection.
+    int index = m_queue.size () - 1;
+    while (index >= 0 && m_active.value (m_queue[index].m_host) >= m_maxConnectionsPerHost)
+    {
+      --index;
+    }
+
+    if (index < 0)
+    {
+      break;
+    }
+
+    SRequest request = m_queue[index];
+    m_queue.remove (index);
+    ++m_active[request.m_host];
+    if (m_rate > 0)
+    {
+      m_tokens -= 1;
+    }
+
+    emit requestReady (request.m_key, request.m_priority);
+  }
+}
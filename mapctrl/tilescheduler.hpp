@@ -0,0 +1,116 @@
+﻿#ifndef TILESCHEDULER_HPP
+#define TILESCHEDULER_HPP
+
+#include "tilekey.hpp"
+#include <QObject>
+#include <QVector>
+#include <QHash>
+#include <QPointF>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <functional>
+#include <algorithm>
+
+/*! \brief The CTileScheduler class is the queue of tile requests waiting to be sent.
+ *
+ *  The requests are sent by priority: first the visible tiles, then the prefetched tiles.
+ *  For the same priority, the tiles nearest the center of the screen are sent first.
+ *  The queue is sorted when the requests are dispatched, so a new center changes the order
+ *  of the requests already queued.
+ *  The number of concurrent requests per host is limited and a token bucket limits the
+ *  request rate to respect the usage policies of the tile servers.
+ *  The signal requestReady is emitted when a request can be sent.
+ */
+class CTileScheduler : public QObject
+{
+  Q_OBJECT
+public:
+  /*! Request priorities. */
+  enum EPriority : quint8 { Visible,  //!< Tile visible on the screen.
+                            Prefetch, //!< Tile probably needed soon.
+                          };
+
+  /*! Constructor. */
+  CTileScheduler (QObject* parent = nullptr);
+
+  /*! Returns the maximum number of concurrent requests per host. */
+  int maxConnectionsPerHost () const { return m_maxConnectionsPerHost; }
+
+  /*! Sets the maximum number of concurrent requests per host. Default 6. */
+  void setMaxConnectionsPerHost (int count) { m_maxConnectionsPerHost = std::max (1, count); }
+
+  /*! Sets the token bucket parameters.
+   *  \param requestsPerSecond: The mean rate. 0 (default) means no rate limit.
+   *  \param burst: The maximum number of requests sent at once.
+   */
+  void setRateLimit (qreal requestsPerSecond, int burst);
+
+  /*! Returns the mean rate. 0 means no rate limit. */
+  qreal rateLimit () const { return m_rate; }
+
+  /*! Sets the center of the screen.
+   *  \param z: The actual zoom.
+   *  \param center: The center in tile coordinates (pixel coordinates / tileSize).
+   */
+  void setCenter (int z, QPointF const & center);
+
+  /*! Adds a request at the queue. The requests are dispatched when the event loop is reached.
+   *  If the tile is already queued, only its priority is raised.
+   */
+  void enqueue (TTileKey key, QString const & host, EPriority priority);
+
+  /*! Raises the priority of a queued request. Returns false if the tile is not queued. */
+  bool promote (TTileKey key, EPriority priority);
+
+  /*! A request sent to host is finished (downloaded, failed or aborted). */
+  void finished (QString const & host);
+
+  /*! Removes the queued requests for which predicate returns true and returns their keys. */
+  QVector<TTileKey> removeIf (std::function<bool (TTileKey)> const & predicate);
+
+  /*! Removes all queued requests. */
+  void clear () { m_queue.clear (); }
+
+  /*! Returns the number of queued requests. */
+  int queuedCount () const { return m_queue.size (); }
+
+  /*! Returns the number of requests sent and not finished. */
+  int activeCount () const;
+
+public slots:
+  /*! Sends the requests allowed by the connection and rate limits. */
+  void dispatch ();
+
+signals:
+  /*! The request can be sent now. */
+  void requestReady (TTileKey key, int priority);
+
+private:
+  struct SRequest
+  {
+    TTileKey m_key;       //!< The tile identifier.
+    QString  m_host;      //!< The server.
+    quint8   m_priority;  //!< See EPriority.
+    float    m_distance2; //!< Square of distance to the center in tiles.
+  };
+
+  void scheduleDispatch ();
+  void sort ();
+  bool hasToken ();
+
+private:
+  QVector<SRequest>   m_queue;                         //!< Sorted from the lowest to the highest priority.
+  QHash<QString, int> m_active;                        //!< Number of requests in progress per host.
+  int                 m_maxConnectionsPerHost = 6;     //!< Max of concurrent requests per host.
+  bool                m_sorted                = true;  //!< The queue is sorted.
+  bool                m_dispatchPending       = false; //!< A dispatch is posted.
+  int                 m_centerZ               = 0;     //!< Zoom of the center.
+  QPointF             m_center;                        //!< Screen center in tile coordinates.
+  qreal               m_rate                  = 0;     //!< Token bucket rate (requests/s).
+  qreal               m_burst                 = 1;     //!< Token bucket capacity.
+  qreal               m_tokens                = 1;     //!< Available tokens.
+  QElapsedTimer       m_bucketClock;                   //!< Time of the last refill.
+  QTimer              m_bucketTimer;                   //!< Waits for the next token.
+};
+
+#endif // TILESCHEDULER_HPP
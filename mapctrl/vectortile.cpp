@@ -0,0 +1,499 @@
+﻿#include "vectortile.hpp"
+#include "../tools/inflater.hpp"
+#include <QPainter>
+#include <algorithm>
+#include <cstring>
+
+/*! \brief The CPbfReader class reads the fields of a protobuf message.
+ *  A truncated message stops the reading and sets the error flag.
+ */
+class CPbfReader
+{
+public:
+  /*! Wire types. */
+  enum EWire { Varint = 0, Fixed64 = 1, Bytes = 2, Fixed32 = 5 };
+
+  CPbfReader (uchar const * data, int size) : m_ptr (data), m_end (data + size) {}
+
+  /*! Reads the next field key. Returns false at the end of the message. */
+  bool next ()
+  {
+    if (m_ptr < m_end)
+    {
+      quint64 key = varint ();
+      m_field     = static_cast<int>(key >> 3);
+      m_wire      = static_cast<int>(key & 7);
+      return !m_error;
+    }
+
+    return false;
+  }
+
+  int field () const { return m_field; }
+  int wire () const { return m_wire; }
+  bool error () const { return m_error; }
+
+  quint64 varint ()
+  {
+    quint64 value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+      if (m_ptr == m_end)
+      {
+        break;
+      }
+
+      uchar byte  = *m_ptr++;
+      value      |= static_cast<quint64>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0)
+      {
+        return value;
+      }
+    }
+
+    stop ();
+    return 0;
+  }
+
+  /*! Reads a length delimited field. */
+  uchar const * bytes (int& size)
+  {
+    quint64 length = varint ();
+    if (length > static_cast<quint64>(m_end - m_ptr))
+    {
+      stop ();
+      size = 0;
+      return nullptr;
+    }
+
+    uchar const * data  = m_ptr;
+    size                = static_cast<int>(length);
+    m_ptr              += size;
+    return data;
+  }
+
+  QString string ()
+  {
+    int           size;
+    uchar const * data = bytes (size);
+    return QString::fromUtf8 (reinterpret_cast<char const *>(data), size);
+  }
+
+  /*! Reads a little endian fixed size field. */
+  quint64 fixed (int size)
+  {
+    quint64 value = 0;
+    if (m_end - m_ptr >= size)
+    {
+      for (int i = 0; i < size; ++i)
+      {
+        value |= static_cast<quint64>(m_ptr[i]) << (8 * i);
+      }
+
+      m_ptr += size;
+    }
+    else
+    {
+      stop ();
+    }
+
+    return value;
+  }
+
+  /*! Skips the actual field. */
+  void skip ()
+  {
+    int size;
+    switch (m_wire)
+    {
+      case Varint :
+        varint ();
+        break;
+
+      case Fixed64 :
+        fixed (8);
+        break;
+
+      case Bytes :
+        bytes (size);
+        break;
+
+      case Fixed32 :
+        fixed (4);
+        break;
+
+      default :
+        stop ();
+        break;
+    }
+  }
+
+private:
+  void stop () { m_error = true; m_ptr = m_end; }
+
+private:
+  uchar const * m_ptr;
+  uchar const * m_end;
+  int           m_field = 0;
+  int           m_wire  = 0;
+  bool          m_error = false;
+};
+
+// Message fields of the vector tile specification.
+enum { TileLayer = 3 };
+enum { LayerName = 1, LayerFeature = 2, LayerKey = 3, LayerValue = 4, LayerExtent = 5 };
+enum { FeatureTags = 2, FeatureType = 3, FeatureGeometry = 4 };
+enum { ValueString = 1, ValueFloat = 2, ValueDouble = 3, ValueInt = 4, ValueUInt = 5, ValueSInt = 6, ValueBool = 7 };
+
+// Geometry commands.
+enum { MoveTo = 1, LineTo = 2, ClosePath = 7 };
+
+static inline qint64 zigzag (quint64 value)
+{
+  return static_cast<qint64>(value >> 1) ^ -static_cast<qint64>(value & 1);
+}
+
+CVectorTile::CVectorTile (QByteArray const & data) : m_data (data)
+{
+  auto bytes = reinterpret_cast<std::uint8_t const *>(data.constData ());
+  if (CInflater::isCompressed (bytes, static_cast<std::size_t>(data.size ())))
+  {
+    std::vector<std::uint8_t> uncompressed;
+    if (!CInflater::uncompress (bytes, static_cast<std::size_t>(data.size ()), uncompressed))
+    {
+      return;
+    }
+
+    m_data = QByteArray (reinterpret_cast<char const *>(uncompressed.data ()), static_cast<int>(uncompressed.size ()));
+  }
+
+  CPbfReader reader (reinterpret_cast<uchar const *>(m_data.constData ()), m_data.size ());
+  while (reader.next ())
+  {
+    if (reader.field () == TileLayer && reader.wire () == CPbfReader::Bytes)
+    {
+      int           size;
+      uchar const * layer = reader.bytes (size);
+      if (layer != nullptr)
+      {
+        readLayer (layer, size);
+      }
+    }
+    else
+    {
+      reader.skip ();
+    }
+  }
+
+  m_valid = !reader.error ();
+}
+
+void CVectorTile::readLayer (uchar const * data, int size)
+{
+  SLayer     layer;
+  CPbfReader reader (data, size);
+  while (reader.next ())
+  {
+    int field = reader.field ();
+    if (field == LayerName && reader.wire () == CPbfReader::Bytes)
+    {
+      layer.m_name = reader.string ();
+    }
+    else if (field == LayerExtent && reader.wire () == CPbfReader::Varint)
+    {
+      layer.m_extent = static_cast<int>(reader.varint ());
+    }
+    else if (field == LayerKey && reader.wire () == CPbfReader::Bytes)
+    {
+      layer.m_keys.append (reader.string ());
+    }
+    else if (field == LayerValue && reader.wire () == CPbfReader::Bytes)
+    { // One of the fields, converted to string to filter the features.
+      int           valueSize;
+      uchar const * value = reader.bytes (valueSize);
+      CPbfReader    valueReader (value, valueSize);
+      QString       text;
+      if (valueReader.next ())
+      {
+        switch (valueReader.field ())
+        {
+          case ValueString :
+            text = valueReader.string ();
+            break;
+
+          case ValueFloat :
+          {
+            quint32 bits = static_cast<quint32>(valueReader.fixed (4));
+            float   real;
+            std::memcpy (&real, &bits, sizeof (real));
+            text = QString::number (real);
+            break;
+          }
+
+          case ValueDouble :
+          {
+            quint64 bits = valueReader.fixed (8);
+            double  real;
+            std::memcpy (&real, &bits, sizeof (real));
+            text = QString::number (real);
+            break;
+          }
+
+          case ValueInt :
+            text = QString::number (static_cast<qint64>(valueReader.varint ()));
+            break;
+
+          case ValueUInt :
+            text = QString::number (valueReader.varint ());
+            break;
+
+          case ValueSInt :
+            text = QString::number (zigzag (valueReader.varint ()));
+            break;
+
+          case ValueBool :
+            text = valueReader.varint () != 0 ? QStringLiteral ("true") : QStringLiteral ("false");
+            break;
+
+          default :
+            break;
+        }
+      }
+
+      layer.m_values.append (text);
+    }
+    else if (field == LayerFeature && reader.wire () == CPbfReader::Bytes)
+    {
+      int           featureSize;
+      uchar const * featureData = reader.bytes (featureSize);
+      CPbfReader    featureReader (featureData, featureSize);
+      SFeature      feature;
+      while (featureReader.next ())
+      {
+        int featureField = featureReader.field ();
+        if (featureField == FeatureType && featureReader.wire () == CPbfReader::Varint)
+        {
+          quint64 type   = featureReader.varint ();
+          feature.m_type = type <= Polygon ? static_cast<EGeometry>(type) : Unknown;
+        }
+        else if (featureField == FeatureTags && featureReader.wire () == CPbfReader::Bytes)
+        {
+          feature.m_tags = featureReader.bytes (feature.m_tagsSize);
+        }
+        else if (featureField == FeatureGeometry && featureReader.wire () == CPbfReader::Bytes)
+        {
+          feature.m_geometry = featureReader.bytes (feature.m_geometrySize);
+        }
+        else
+        {
+          featureReader.skip ();
+        }
+      }
+
+      if (feature.m_type != Unknown && feature.m_geometry != nullptr)
+      {
+        layer.m_features.append (feature);
+      }
+    }
+    else
+    {
+      reader.skip ();
+    }
+  }
+
+  if (!reader.error () && layer.m_extent > 0)
+  {
+    m_layers.append (layer);
+  }
+}
+
+CVectorTile::SLayer const * CVectorTile::layer (QString const & name) const
+{
+  for (SLayer const & layer : m_layers)
+  {
+    if (layer.m_name == name)
+    {
+      return &layer;
+    }
+  }
+
+  return nullptr;
+}
+
+int CVectorTile::value (SFeature const & feature, int key)
+{
+  CPbfReader reader (feature.m_tags, feature.m_tagsSize);
+  while (!reader.error ())
+  {
+    // The end of the tags is detected by the error of the first varint.
+    int tagKey   = static_cast<int>(reader.varint ());
+    int tagValue = static_cast<int>(reader.varint ());
+    if (!reader.error () && tagKey == key)
+    {
+      return tagValue;
+    }
+  }
+
+  return -1;
+}
+
+void CVectorTile::appendPath (SFeature const & feature, qreal scale, QPainterPath& path, qreal pointRadius)
+{
+  // The coordinates are relative at the previous point, from the tile origin for the first command.
+  CPbfReader reader (feature.m_geometry, feature.m_geometrySize);
+  qint64     x = 0, y = 0;
+  while (!reader.error ())
+  {
+    quint64 command = reader.varint ();
+    if (reader.error ())
+    {
+      break;
+    }
+
+    int id    = static_cast<int>(command & 7);
+    int count = static_cast<int>(command >> 3);
+    if (id == ClosePath)
+    {
+      path.closeSubpath ();
+    }
+    else if (id == MoveTo || id == LineTo)
+    {
+      for (int i = 0; i < count && !reader.error (); ++i)
+      {
+        x += zigzag (reader.varint ());
+        y += zigzag (reader.varint ());
+        QPointF point (x * scale, y * scale);
+        if (feature.m_type == Point)
+        {
+          path.addEllipse (point, pointRadius, pointRadius);
+        }
+        else if (id == MoveTo)
+        {
+          path.moveTo (point);
+        }
+        else
+        {
+          path.lineTo (point);
+        }
+      }
+    }
+    else
+    {
+      break;
+    }
+  }
+}
+
+CVectorTileRenderer::CVectorTileRenderer (SVectorTileStyle const & style, int tileSize, qreal pixelRatio) :
+  m_style (style), m_tileSize (tileSize), m_pixelRatio (pixelRatio)
+{
+}
+
+bool CVectorTileRenderer::isVectorFormat (QByteArray const & format)
+{
+  return format.compare ("PBF", Qt::CaseInsensitive) == 0 || format.compare ("MVT", Qt::CaseInsensitive) == 0;
+}
+
+QImage CVectorTileRenderer::render (QByteArray const & data, int zoom) const
+{
+  CVectorTile tile (data);
+  if (!tile.isValid ())
+  {
+    return QImage ();
+  }
+
+  int    size = qRound (m_tileSize * m_pixelRatio);
+  QImage image (size, size, QImage::Format_ARGB32_Premultiplied);
+  image.setDevicePixelRatio (m_pixelRatio);
+  image.fill (m_style.m_background);
+
+  // The painter uses tile pixels, the device pixel ratio is applied by QPainter.
+  QPainter painter (&image);
+  painter.setRenderHint (QPainter::Antialiasing);
+  for (SVectorTileRule const & rule : m_style.m_rules)
+  {
+    CVectorTile::SLayer const * layer = zoom >= rule.m_zoomMin && zoom <= rule.m_zoomMax ? tile.layer (rule.m_layer) : nullptr;
+    if (layer != nullptr)
+    {
+      int key = -1;
+      if (!rule.m_key.isEmpty ())
+      {
+        key = layer->m_keys.indexOf (rule.m_key);
+        if (key == -1)
+        {
+          continue;
+        }
+      }
+
+      // All features of the rule in one path, so one drawing per rule.
+      QPainterPath path;
+      path.setFillRule (Qt::WindingFill);
+      qreal scale  = static_cast<qreal>(m_tileSize) / layer->m_extent;
+      qreal radius = std::max<qreal> (1, rule.m_pen.widthF ());
+      for (CVectorTile::SFeature const & feature : layer->m_features)
+      {
+        if (rule.m_geometry == CVectorTile::Unknown || rule.m_geometry == feature.m_type)
+        {
+          if (key != -1)
+          {
+            int value = CVectorTile::value (feature, key);
+            if (value < 0 || value >= layer->m_values.size () || !rule.m_values.contains (layer->m_values[value]))
+            {
+              continue;
+            }
+          }
+
+          CVectorTile::appendPath (feature, scale, path, radius);
+        }
+      }
+
+      if (!path.isEmpty ())
+      {
+        painter.setPen (rule.m_pen);
+        painter.setBrush (rule.m_geometry == CVectorTile::LineString ? QBrush () : rule.m_brush);
+        painter.drawPath (path);
+      }
+    }
+  }
+
+  return image;
+}
+
+SVectorTileStyle SVectorTileStyle::defaultStyle ()
+{
+  SVectorTileStyle style;
+  style.m_background = QColor (242, 239, 233);
+
+  QVector<SVectorTileRule>& rules = style.m_rules;
+  rules.append (SVectorTileRule ("landcover", CVectorTile::Polygon, Qt::NoPen, QColor (173, 209, 158))
+                .filter ("class", { "wood", "forest" }));
+  rules.append (SVectorTileRule ("landcover", CVectorTile::Polygon, Qt::NoPen, QColor (205, 235, 176))
+                .filter ("class", { "grass", "farmland", "wetland" }));
+  rules.append (SVectorTileRule ("landuse", CVectorTile::Polygon, Qt::NoPen, QColor (224, 223, 223))
+                .filter ("class", { "residential", "suburb", "neighbourhood" }));
+  rules.append (SVectorTileRule ("landuse", CVectorTile::Polygon, Qt::NoPen, QColor (235, 219, 232))
+                .filter ("class", { "commercial", "industrial", "retail" }));
+  rules.append (SVectorTileRule ("park", CVectorTile::Polygon, Qt::NoPen, QColor (200, 250, 204)));
+  rules.append (SVectorTileRule ("water", CVectorTile::Polygon, Qt::NoPen, QColor (170, 211, 223)));
+  rules.append (SVectorTileRule ("waterway", CVectorTile::LineString, QPen (QColor (170, 211, 223), 1.2)).zoom (8));
+  rules.append (SVectorTileRule ("building", CVectorTile::Polygon, QPen (QColor (196, 182, 171), 0.5), QColor (217, 208, 201)).zoom (14));
+
+  QPen minor (Qt::white, 1.5);
+  QPen path (QColor (250, 128, 114), 0.8, Qt::DashLine);
+  rules.append (SVectorTileRule ("transportation", CVectorTile::LineString, path).filter ("class", { "path", "track" }).zoom (14));
+  rules.append (SVectorTileRule ("transportation", CVectorTile::LineString, minor).filter ("class", { "minor", "service" }).zoom (12));
+  rules.append (SVectorTileRule ("transportation", CVectorTile::LineString, QPen (QColor (153, 153, 153), 1))
+                .filter ("class", { "rail", "transit" }).zoom (10));
+  rules.append (SVectorTileRule ("transportation", CVectorTile::LineString, QPen (QColor (247, 250, 191), 2))
+                .filter ("class", { "secondary", "tertiary" }).zoom (9));
+  rules.append (SVectorTileRule ("transportation", CVectorTile::LineString, QPen (QColor (252, 214, 164), 2.5))
+                .filter ("class", { "primary" }).zoom (7));
+  rules.append (SVectorTileRule ("transportation", CVectorTile::LineString, QPen (QColor (232, 146, 162), 3))
+                .filter ("class", { "motorway", "trunk" }).zoom (5));
+
+  QPen country (QColor (141, 97, 139), 1.5);
+  QPen region (QColor (141, 97, 139), 1, Qt::DashLine);
+  rules.append (SVectorTileRule ("boundary", CVectorTile::LineString, region).filter ("admin_level", { "3", "4" }));
+  rules.append (SVectorTileRule ("boundary", CVectorTile::LineString, country).filter ("admin_level", { "2" }));
+  return style;
+}
@@ -0,0 +1,155 @@
+﻿#ifndef VECTORTILE_HPP
+#define VECTORTILE_HPP
+
+#include <QImage>
+#include <QPainterPath>
+#include <QPen>
+#include <QBrush>
+#include <QHash>
+#include <QVector>
+#include <QStringList>
+
+/*! \brief The CVectorTile class reads a Mapbox Vector Tile (protobuf, https://github.com/mapbox/vector-tile-spec).
+ *
+ *  The tile can be compressed (gzip or zlib), as in most MBTiles files. The layers, the features and
+ *  the tags are indexed without copy, the geometry of a feature is decoded only when its path is requested.
+ *  The tile must be kept while its features are used.
+ */
+class CVectorTile
+{
+public:
+  /*! Geometry types of the features. */
+  enum EGeometry : quint8 { Unknown,
+                            Point,
+                            LineString,
+                            Polygon,
+                          };
+
+  /*! A feature. The tags and the geometry are packed integers in the tile data. */
+  struct SFeature
+  {
+    EGeometry     m_type         = Unknown; //!< The geometry type.
+    uchar const * m_tags         = nullptr; //!< Pairs of key index, value index.
+    int           m_tagsSize     = 0;       //!< The size of the tags in bytes.
+    uchar const * m_geometry     = nullptr; //!< Geometry commands.
+    int           m_geometrySize = 0;       //!< The size of the geometry in bytes.
+  };
+
+  /*! A layer. */
+  struct SLayer
+  {
+    QString           m_name;          //!< The name (e.g. "water").
+    int               m_extent = 4096; //!< The size of the tile in geometry units.
+    QStringList       m_keys;          //!< The tag keys.
+    QStringList       m_values;        //!< The tag values converted in strings.
+    QVector<SFeature> m_features;      //!< The features.
+  };
+
+  /*! Constructor.
+   *  \param data: The tile data, compressed or not.
+   */
+  CVectorTile (QByteArray const & data);
+
+  /*! Returns true if the tile has been read without error. */
+  bool isValid () const { return m_valid; }
+
+  /*! Returns the layers. */
+  QVector<SLayer> const & layers () const { return m_layers; }
+
+  /*! Returns the layer or nullptr if the tile does not contain the layer. */
+  SLayer const * layer (QString const & name) const;
+
+  /*! Returns the index of the value of the key in layer values or -1 if the feature has not the key.
+   *  \param feature: The feature.
+   *  \param key: The key index in layer keys.
+   */
+  static int value (SFeature const & feature, int key);
+
+  /*! Appends the geometry of the feature at path.
+   *  \param feature: The feature.
+   *  \param scale: The size of a geometry unit in the path coordinates (e.g. tileSize / extent).
+   *  \param path: The path. The points are added as small circles of radius pointRadius.
+   *  \param pointRadius: The radius of the points.
+   */
+  static void appendPath (SFeature const & feature, qreal scale, QPainterPath& path, qreal pointRadius = 1);
+
+private:
+  void readLayer (uchar const * data, int size);
+
+private:
+  QByteArray      m_data;          //!< The uncompressed tile.
+  QVector<SLayer> m_layers;        //!< The layers.
+  bool            m_valid = false; //!< Read without error.
+};
+
+/*! Drawing of the features of a vector tile layer, similar at a layer of a Mapbox style. */
+struct SVectorTileRule
+{
+  SVectorTileRule () = default;
+  SVectorTileRule (QString const & layer, CVectorTile::EGeometry geometry, QPen const & pen, QBrush const & brush = Qt::NoBrush) :
+    m_layer (layer), m_geometry (geometry), m_pen (pen), m_brush (brush) {}
+
+  /*! Sets the feature filter and returns this. */
+  SVectorTileRule& filter (QString const & key, QStringList const & values) { m_key = key; m_values = values; return *this; }
+
+  /*! Sets the zoom range and returns this. */
+  SVectorTileRule& zoom (int zoomMin, int zoomMax = 24) { m_zoomMin = zoomMin; m_zoomMax = zoomMax; return *this; }
+
+  QString                m_layer;                          //!< The tile layer.
+  CVectorTile::EGeometry m_geometry = CVectorTile::Polygon; //!< The geometry drawn. Unknown means all geometries.
+  QPen                   m_pen      = Qt::NoPen;           //!< Pen of lines, polygon contours and points.
+  QBrush                 m_brush;                          //!< Brush of polygons and points.
+  QString                m_key;                            //!< Key of the filter. Empty means all features.
+  QStringList            m_values;                         //!< Values of m_key accepted by the filter.
+  int                    m_zoomMin  = 0;                   //!< The minimum zoom.
+  int                    m_zoomMax  = 24;                  //!< The maximum zoom.
+};
+
+/*! Style of the vector tiles. The rules are drawn in order, like the layers of a Mapbox style. */
+struct SVectorTileStyle
+{
+  QColor                   m_background = Qt::white; //!< Background of the tiles.
+  QVector<SVectorTileRule> m_rules;                  //!< The rules in drawing order.
+
+  /*! Returns a light style for the OpenMapTiles schema (https://openmaptiles.org/schema). */
+  static SVectorTileStyle defaultStyle ();
+};
+
+/*! \brief The CVectorTileRenderer class draws vector tiles in images with a style.
+ *
+ *  The renderer is immutable and can be shared by the decoding threads.
+ *  The images have the format QImage::Format_ARGB32_Premultiplied and are tileSize * pixelRatio wide.
+ *  Their device pixel ratio is pixelRatio, so they are drawn at tileSize.
+ */
+class CVectorTileRenderer
+{
+public:
+  /*! Constructor.
+   *  \param style: The style.
+   *  \param tileSize: The size of the tiles in pixels.
+   *  \param pixelRatio: The device pixel ratio of the images.
+   */
+  CVectorTileRenderer (SVectorTileStyle const & style, int tileSize = 256, qreal pixelRatio = 1);
+
+  /*! Returns the style. */
+  SVectorTileStyle const & style () const { return m_style; }
+
+  /*! Returns the device pixel ratio of the images. */
+  qreal pixelRatio () const { return m_pixelRatio; }
+
+  /*! Returns the image of a tile or a null image if the data are not a vector tile.
+   *  \param data: The tile data, compressed or not.
+   *  \param zoom: The zoom of the tile used to select the rules.
+   */
+  QImage render (QByteArray const & data, int zoom) const;
+
+  /*! Returns true if the format (e.g. "PBF", "MVT") is a vector tile format. */
+  static bool isVectorFormat (QByteArray const & format);
+
+private:
+  SVectorTileStyle m_style;      //!< The style.
+  int              m_tileSize;   //!< Size of the tiles.
+  qreal            m_pixelRatio; //!< Device pixel ratio.
+};
+
+#endif // VECTORTILE_HPP
@@ -187,7 +187,9 @@ void CMainWindow::on_actionOSM_triggered (bool)
   if (adapter == nullptr || adapter->name () != "osm")
   {
     QString apiKey; // Funderforest (OSM map) API key looks like QString apiKey ("f1024a76c381244ad3f121853043f302");
-    ui->m_map->setTiteAdapter (new COsmTileAdapter (apiKey));
+    CTileAdapter* newAdapter = new COsmTileAdapter (apiKey);
+    newAdapter->setPersistentDiskCache (); // Tiles kept between sessions and provider switches.
+    ui->m_map->setTiteAdapter (newAdapter);
     updateMapTypeNemu ();
   }
 
@@ -200,7 +202,9 @@ void CMainWindow::on_actionMapbox_triggered (bool)
   CTileAdapter* adapter = ui->m_map->tileAdapter ();
   if (adapter == nullptr || adapter->name () != "mapbox")
   {
-    ui->m_map->setTiteAdapter (new CMapboxTileAdapter);
+    CTileAdapter* newAdapter = new CMapboxTileAdapter;
+    newAdapter->setPersistentDiskCache ();
+    ui->m_map->setTiteAdapter (newAdapter);
     updateMapTypeNemu ();
   }
 
@@ -211,9 +215,11 @@ void CMainWindow::on_actionMapbox_triggered (bool)
 void CMainWindow::on_actionESRI_triggered (bool)
 {
   CTileAdapter* adapter = ui->m_map->tileAdapter ();
-  if (adapter == nullptr || adapter->name () != "ersi")
+  if (adapter == nullptr || adapter->name () != "esri")
   {
-    ui->m_map->setTiteAdapter (new CEsriTileAdapter);
+    CTileAdapter* newAdapter = new CEsriTileAdapter;
+    newAdapter->setPersistentDiskCache ();
+    ui->m_map->setTiteAdapter (newAdapter);
     updateMapTypeNemu ();
   }
 
@@ -0,0 +1,113 @@
+﻿/* This tool downloads the tiles of a region in the persistent disk cache used by the tile adapters
+ * (see CTileAdapter::setPersistentDiskCache), so the map is displayed without downloading.
+ *
+ * Example: seed --provider osm --bbox 4.7,45.85,4.95,45.7 --zoom 10-16
+ *
+ * The region is given by the longitude and latitude of its top left and bottom right corners.
+ * The tiles already in the cache are skipped, running the same command again resumes an
+ * interrupted seeding. The tiles of the region can also be written in a tile pack (--pack).
+ *
+ * Respect the usage policies of the tile servers. Most of them forbid heavy bulk downloads.
+ */
+
+#include "seeder.hpp"
+#include "../mapctrl/osmtileadapter.hpp"
+#include "../mapctrl/esritileadapter.hpp"
+#include "../mapctrl/mapboxtileadapter.hpp"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+
+int main (int argc, char* argv[])
+{
+  QCoreApplication app (argc, argv);
+  QCommandLineParser parser;
+  parser.setApplicationDescription (QStringLiteral ("Downloads the tiles of a region in the persistent tile cache."));
+  parser.addHelpOption ();
+  QCommandLineOption providerOption ({ "p", "provider" }, QStringLiteral ("Tile provider: osm (default), esri or mapbox."), "provider", "osm");
+  QCommandLineOption indexOption ({ "i", "index" }, QStringLiteral ("Map index of the provider (default 0)."), "index", "0");
+  QCommandLineOption keyOption ({ "k", "api-key" }, QStringLiteral ("API key of the provider."), "key");
+  QCommandLineOption bboxOption ({ "b", "bbox" }, QStringLiteral ("Region: left,top,right,bottom in degrees (longitude,latitude)."), "bbox");
+  QCommandLineOption zoomOption ({ "z", "zoom" }, QStringLiteral ("Zoom levels: min-max or a single level."), "zoom");
+  QCommandLineOption sizeOption ({ "s", "max-size" }, QStringLiteral ("Budget of the cache in Mbytes (default 1024)."), "size", "1024");
+  QCommandLineOption appOption ({ "a", "app" }, QStringLiteral ("Application using the cache (default sample)."), "name", "sample");
+  QCommandLineOption packOption ({ "o", "pack" }, QStringLiteral ("Writes also the tiles of the region in a tile pack."), "file");
+  parser.addOptions ({ providerOption, indexOption, keyOption, bboxOption, zoomOption, sizeOption, appOption, packOption });
+  parser.process (app);
+
+  QTextStream err (stderr);
+  QStringList bbox = parser.value (bboxOption).split (',');
+  QStringList zoom = parser.value (zoomOption).split ('-');
+  if (bbox.size () != 4 || zoom.isEmpty () || zoom.size () > 2 || zoom.first ().isEmpty ())
+  {
+    err << parser.helpText ();
+    return 1;
+  }
+
+  // The cache is in the cache location of the application displaying the map.
+  QCoreApplication::setApplicationName (parser.value (appOption));
+
+  CTileAdapter* adapter  = nullptr;
+  QString       provider = parser.value (providerOption);
+  if (provider == QLatin1String ("osm"))
+  {
+    adapter = new COsmTileAdapter (parser.value (keyOption));
+  }
+  else if (provider == QLatin1String ("esri"))
+  {
+    adapter = new CEsriTileAdapter;
+  }
+  else if (provider == QLatin1String ("mapbox"))
+  {
+    adapter = new CMapboxTileAdapter (parser.value (keyOption));
+  }
+  else
+  {
+    err << QStringLiteral ("Unknown provider: ") << provider << '\n';
+    return 1;
+  }
+
+  int index = parser.value (indexOption).toInt ();
+  if (index < 0 || index >= adapter->urls ().size ())
+  {
+    err << QStringLiteral ("Invalid map index: ") << index << '\n';
+    delete adapter;
+    return 1;
+  }
+
+  adapter->setUrlIndex (index);
+  adapter->setDecoding (false);
+  adapter->setPersistentDiskCache (parser.value (sizeOption).toInt ());
+
+  CSeeder::SRegion region;
+  region.m_topLeft     = TGeoCoord (bbox[0].toDouble (), bbox[1].toDouble ());
+  region.m_bottomRight = TGeoCoord (bbox[2].toDouble (), bbox[3].toDouble ());
+  region.m_zoomMin     = qBound (adapter->zoomMin (), zoom.first ().toInt (), adapter->zoomMax ());
+  region.m_zoomMax     = qBound (adapter->zoomMin (), zoom.last ().toInt (), adapter->zoomMax ());
+
+  CSeeder seeder (adapter, region);
+  QTextStream (stdout) << QStringLiteral ("%1 tiles in %2\n").arg (seeder.tileCount ()).arg (adapter->persistentDiskCache ()->directory ());
+  qint64 const meanTileSize = 20 * 1024; // Rough size of an encoded tile.
+  if (seeder.tileCount () * meanTileSize > adapter->persistentDiskCache ()->maxSize ())
+  {
+    err << QStringLiteral ("Warning: the region probably exceeds the budget of the cache, the first tiles can be removed.\n");
+  }
+
+  QObject::connect (&seeder, &CSeeder::finished, &app, &QCoreApplication::quit);
+  seeder.start ();
+  app.exec ();
+
+  int code = seeder.failedCount () == 0 ? 0 : 2;
+  if (parser.isSet (packOption))
+  {
+    QString message;
+    if (!seeder.writePack (parser.value (packOption), &message))
+    {
+      err << QStringLiteral ("Cannot write the tile pack: ") << message << '\n';
+      code = 1;
+    }
+  }
+
+  delete adapter;
+  return code;
+}
@@ -0,0 +1,20 @@
+QT       += core gui widgets network sql
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+include(../optimize.pri)
+
+SOURCES += \
+    main.cpp \
+    seeder.cpp
+
+HEADERS += \
+    seeder.hpp
+
+LIBNAME = mapctrl
+include(../pretargetdeps.pri)
+include(../libneeded.pri)
+LIBNAME = tools
+include(../pretargetdeps.pri)
+include(../libneeded.pri)
@@ -0,0 +1,160 @@
+﻿#include "seeder.hpp"
+#include "../mapctrl/tilepack.hpp"
+#include <QTextStream>
+
+CSeeder::CSeeder (CTileAdapter* adapter, SRegion const & region, int window, QObject* parent) :
+  QObject (parent), m_adapter (adapter), m_region (region), m_window (std::max (1, window)), m_z (region.m_zoomMin)
+{
+  for (int z = m_region.m_zoomMin; z <= m_region.m_zoomMax; ++z)
+  {
+    QRect rect = tileRect (z);
+    m_total   += static_cast<qint64>(rect.width ()) * rect.height ();
+  }
+
+  m_rect = tileRect (m_z);
+  m_next = m_rect.topLeft ();
+  connect (m_adapter, &CTileAdapter::tileDownloaded, this, &CSeeder::tileDownloaded);
+  connect (m_adapter, &CTileAdapter::downloadFailed, this, &CSeeder::downloadFailed);
+  m_reportTimer.setInterval (1000);
+  connect (&m_reportTimer, &QTimer::timeout, this, &CSeeder::report);
+}
+
+QRect CSeeder::tileRect (int z) const
+{
+  // Web Mercator is limited to +/-85.0511 degrees of latitude.
+  TCoordType const maxLatitude = static_cast<TCoordType>(85.0511);
+  TGeoCoord        topLeft (m_region.m_topLeft.x (), qBound (-maxLatitude, m_region.m_topLeft.y (), maxLatitude));
+  TGeoCoord        bottomRight (m_region.m_bottomRight.x (), qBound (-maxLatitude, m_region.m_bottomRight.y (), maxLatitude));
+
+  int    tileSize = m_adapter->tileSize ();
+  int    last     = CTileAdapter::tileCountOnZoom (z) - 1;
+  QPoint p0       = m_adapter->coordinatesToViewport (topLeft, z);
+  QPoint p1       = m_adapter->coordinatesToViewport (bottomRight, z);
+  return QRect (QPoint (qBound (0, std::min (p0.x (), p1.x ()) / tileSize, last), qBound (0, std::min (p0.y (), p1.y ()) / tileSize, last)),
+                QPoint (qBound (0, std::max (p0.x (), p1.x ()) / tileSize, last), qBound (0, std::max (p0.y (), p1.y ()) / tileSize, last)));
+}
+
+bool CSeeder::nextTile (TTileKey& key)
+{
+  while (m_z <= m_region.m_zoomMax)
+  {
+    if (m_next.x () <= m_rect.right ())
+    {
+      key = m_adapter->tileKey (m_next.x (), m_next.y (), m_z);
+      if (m_next.y () < m_rect.bottom ())
+      {
+        m_next.ry () += 1;
+      }
+      else
+      {
+        m_next = QPoint (m_next.x () + 1, m_rect.top ());
+      }
+
+      return true;
+    }
+
+    if (++m_z <= m_region.m_zoomMax)
+    {
+      m_rect = tileRect (m_z);
+      m_next = m_rect.topLeft ();
+    }
+  }
+
+  return false;
+}
+
+void CSeeder::start ()
+{
+  m_clock.start ();
+  m_reportTimer.start ();
+  QTimer::singleShot (0, this, &CSeeder::feed); // finished is emitted from the event loop.
+}
+
+void CSeeder::feed ()
+{
+  // The tiles already downloaded by a previous run are skipped.
+  CTileDiskCache* cache = m_adapter->persistentDiskCache ();
+  TTileKey        key;
+  while (m_pending.size () < m_window && nextTile (key))
+  {
+    if (cache != nullptr && cache->contains (key))
+    {
+      ++m_skipped;
+    }
+    else
+    {
+      m_pending.insert (key);
+      m_adapter->tile (tileKeyX (key), tileKeyY (key), tileKeyZ (key), CTileScheduler::Prefetch);
+    }
+  }
+
+  if (m_pending.isEmpty ())
+  {
+    m_reportTimer.stop ();
+    report ();
+    emit finished ();
+  }
+}
+
+void CSeeder::tileDownloaded (TTileKey key)
+{
+  if (m_pending.remove (key))
+  {
+    ++m_downloaded;
+    feed ();
+  }
+}
+
+void CSeeder::downloadFailed (TTileKey key)
+{
+  if (m_pending.remove (key))
+  {
+    ++m_failed;
+    feed ();
+  }
+}
+
+void CSeeder::report ()
+{
+  qint64      done    = m_skipped + m_downloaded + m_failed;
+  double      seconds = m_clock.elapsed () / 1000.0;
+  double      rate    = seconds > 0 ? m_downloaded / seconds : 0;
+  QTextStream out (stdout);
+  out << QStringLiteral ("%1/%2 tiles (%3%), %4 downloaded, %5 skipped, %6 failed, %7 tiles/s")
+         .arg (done).arg (m_total).arg (m_total != 0 ? 100.0 * done / m_total : 100.0, 0, 'f', 1)
+         .arg (m_downloaded).arg (m_skipped).arg (m_failed).arg (rate, 0, 'f', 1) << '\n';
+}
+
+bool CSeeder::writePack (QString const & fileName, QString* error) const
+{
+  CTileDiskCache* cache = m_adapter->persistentDiskCache ();
+  if (cache == nullptr)
+  {
+    return false;
+  }
+
+  CTilePackWriter writer (m_adapter->imageFormat (), m_adapter->tileSize ());
+  for (int z = m_region.m_zoomMin; z <= m_region.m_zoomMax; ++z)
+  {
+    QRect rect = tileRect (z);
+    for (int x = rect.left (); x <= rect.right (); ++x)
+    {
+      for (int y = rect.top (); y <= rect.bottom (); ++y)
+      {
+        TTileKey key = m_adapter->tileKey (x, y, z);
+        if (cache->contains (key))
+        {
+          writer.addFile (key, cache->fileName (key));
+        }
+      }
+    }
+  }
+
+  bool ok = writer.write (fileName);
+  if (!ok && error != nullptr)
+  {
+    *error = writer.errorString ();
+  }
+
+  return ok;
+}
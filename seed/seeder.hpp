@@ -0,0 +1,77 @@
+﻿#ifndef SEEDER_HPP
+#define SEEDER_HPP
+
+#include "../mapctrl/tileadapter.hpp"
+#include <QTimer>
+#include <QElapsedTimer>
+
+/*! \brief The CSeeder class downloads all tiles of a region in the persistent disk cache of a tile adapter.
+ *
+ *  The tiles are queued by windows in the scheduler of the adapter which sends them within the
+ *  connection and rate limits of the server. The tiles already in the persistent disk cache are
+ *  skipped, so an interrupted seeding is resumed by running it again.
+ *  The progress is reported every second on the standard output.
+ */
+class CSeeder : public QObject
+{
+  Q_OBJECT
+public:
+  /*! Region to download. */
+  struct SRegion
+  {
+    TGeoCoord m_topLeft;     //!< Longitude and latitude of the top left corner.
+    TGeoCoord m_bottomRight; //!< Longitude and latitude of the bottom right corner.
+    int       m_zoomMin = 0; //!< First zoom level.
+    int       m_zoomMax = 0; //!< Last zoom level.
+  };
+
+  /*! Constructor.
+   *  \param adapter: The tile adapter. The persistent disk cache must be set.
+   *  \param region: The region to download.
+   *  \param window: The maximum number of tiles queued at the same time.
+   */
+  CSeeder (CTileAdapter* adapter, SRegion const & region, int window = 256, QObject* parent = nullptr);
+
+  /*! Returns the number of tiles of the region. */
+  qint64 tileCount () const { return m_total; }
+
+  /*! Returns the number of failed downloads. */
+  qint64 failedCount () const { return m_failed; }
+
+  /*! Starts the download. finished is emitted when all tiles are processed. */
+  void start ();
+
+  /*! Writes the tiles of the region found in the persistent disk cache in a tile pack. */
+  bool writePack (QString const & fileName, QString* error = nullptr) const;
+
+signals:
+  /*! All tiles are downloaded, skipped or failed. */
+  void finished ();
+
+private slots:
+  void tileDownloaded (TTileKey key);
+  void downloadFailed (TTileKey key);
+  void report ();
+
+private:
+  QRect tileRect (int z) const;
+  bool nextTile (TTileKey& key);
+  void feed ();
+
+private:
+  CTileAdapter*  m_adapter;        //!< The tile adapter.
+  SRegion        m_region;         //!< The region.
+  int            m_window;         //!< The maximum number of tiles queued.
+  int            m_z;              //!< Zoom of the next tile.
+  QPoint         m_next;           //!< Coordinates of the next tile.
+  QRect          m_rect;           //!< Tiles of the region at m_z.
+  QSet<TTileKey> m_pending;        //!< Tiles queued or downloading.
+  qint64         m_total      = 0; //!< Tiles of the region.
+  qint64         m_skipped    = 0; //!< Tiles already in the cache.
+  qint64         m_downloaded = 0; //!< Downloaded tiles.
+  qint64         m_failed     = 0; //!< Failed downloads.
+  QTimer         m_reportTimer;    //!< Timer of progress reports.
+  QElapsedTimer  m_clock;          //!< Duration of the download.
+};
+
+#endif // SEEDER_HPP
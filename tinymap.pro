@@ -6,3 +6,6 @@ SUBDIRS += \
   town \
   mapctrl \
   sample
+
+# The seeder fills the disk cache from a command line, not available in a browser.
+!wasm: SUBDIRS += seed
@@ -0,0 +1,275 @@
+﻿#ifndef FLATHASH_HPP
+#define FLATHASH_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/*! \brief The CFlatHash class is an open addressing hash table with 64 bits integer keys.
+ *
+ *  All the elements are stored in a single array (linear probing). The lookup does not allocate
+ *  memory and uses only one or two cache lines. The key ~0 is reserved to mark the empty slots.
+ *  The removal uses backward shifting, therefore there is no tombstone.
+ */
+template<typename T>
+class CFlatHash
+{
+public:
+  using TKey = std::uint64_t;
+
+  /*! The reserved key of empty slots. */
+  static TKey const EmptyKey = ~static_cast<TKey>(0);
+
+  /*! Constructor.
+   *  \param capacity: The initial number of slots. It is rounded at the next power of 2.
+   */
+  inline CFlatHash (std::size_t capacity = 64);
+
+  /*! Returns the number of elements. */
+  std::size_t size () const { return m_size; }
+
+  /*! Returns true if the table has no element. */
+  bool isEmpty () const { return m_size == 0; }
+
+  /*! Returns true if the table contains the key. */
+  bool contains (TKey key) const { return find (key) != nullptr; }
+
+  /*! Returns a pointer on the value of the key or nullptr if the key does not exist. */
+  inline T* find (TKey key);
+
+  /*! Returns a pointer on the value of the key or nullptr if the key does not exist. */
+  inline T const * find (TKey key) const;
+
+  /*! Returns the value of the key or defaultValue if the key does not exist. */
+  inline T value (TKey key, T const & defaultValue = T ()) const;
+
+  /*! Returns the reference on the value of the key. If the key does not exist a default value is inserted. */
+  inline T& operator [] (TKey key);
+
+  /*! Inserts or replaces the value of the key. */
+  void insert (TKey key, T const & value) { (*this)[key] = value; }
+
+  /*! Removes the key. Returns true if the key existed. */
+  inline bool remove (TKey key);
+
+  /*! Removes all elements for which predicate (key, value) returns true. Returns the number of removed elements. */
+  template<typename TPredicate>
+  inline std::size_t removeIf (TPredicate predicate);
+
+  /*! Calls function (key, value) for all elements. */
+  template<typename TFunction>
+  inline void forEach (TFunction function) const;
+
+  /*! Removes all elements. The capacity is not changed. */
+  inline void clear ();
+
+  /*! Reserves slots for count elements. */
+  inline void reserve (std::size_t count);
+
+private:
+  struct SSlot
+  {
+    TKey m_key = EmptyKey;
+    T    m_value;
+  };
+
+  /*! Mixes the bits of the key (64 bits finalizer of MurmurHash3). */
+  static inline std::size_t hash (TKey key);
+
+  /*! Returns the index of the key or the index of the empty slot where the key must be inserted. */
+  inline std::size_t slotIndex (TKey key) const;
+
+  /*! Rebuilds the table with capacity slots. */
+  inline void rehash (std::size_t capacity);
+
+private:
+  std::vector<SSlot> m_slots;    //!< The slots. The size is a power of 2.
+  std::size_t        m_mask = 0; //!< Slot count - 1.
+  std::size_t        m_size = 0; //!< Number of elements.
+};
+
+template<typename T>
+CFlatHash<T>::CFlatHash (std::size_t capacity)
+{
+  std::size_t count = 8;
+  while (count < capacity)
+  {
+    count <<= 1;
+  }
+
+  m_slots.resize (count);
+  m_mask = count - 1;
+}
+
+template<typename T>
+std::size_t CFlatHash<T>::hash (TKey key)
+{
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  key *= 0xc4ceb9fe1a85ec53ULL;
+  key ^= key >> 33;
+  return static_cast<std::size_t>(key);
+}
+
+template<typename T>
+std::size_t CFlatHash<T>::slotIndex (TKey key) const
+{
+  std::size_t index = hash (key) & m_mask;
+  while (m_slots[index].m_key != key && m_slots[index].m_key != EmptyKey)
+  {
+    index = (index + 1) & m_mask;
+  }
+
+  return index;
+}
+
+template<typename T>
+T* CFlatHash<T>::find (TKey key)
+{
+  SSlot& slot = m_slots[slotIndex (key)];
+  return slot.m_key == key && key != EmptyKey ? &slot.m_value : nullptr;
+}
+
+template<typename T>
+T const * CFlatHash<T>::find (TKey key) const
+{
+  SSlot const & slot = m_slots[slotIndex (key)];
+  return slot.m_key == key && key != EmptyKey ? &slot.m_value : nullptr;
+}
+
+template<typename T>
+T CFlatHash<T>::value (TKey key, T const & defaultValue) const
+{
+  T const * value = find (key);
+  return value != nullptr ? *value : defaultValue;
+}
+
+template<typename T>
+T& CFlatHash<T>::operator [] (TKey key)
+{
+  std::size_t index = slotIndex (key);
+  if (m_slots[index].m_key != key)
+  {
+    // Maximum load factor 0.5 to keep probe sequences short.
+    if ((m_size + 1) * 2 > m_slots.size ())
+    {
+      rehash (m_slots.size () * 2);
+      index = slotIndex (key);
+    }
+
+    m_slots[index].m_key   = key;
+    m_slots[index].m_value = T ();
+    ++m_size;
+  }
+
+  return m_slots[index].m_value;
+}
+
+template<typename T>
+bool CFlatHash<T>::remove (TKey key)
+{
+  std::size_t index = slotIndex (key);
+  if (key == EmptyKey || m_slots[index].m_key != key)
+  {
+    return false;
+  }
+
+  // Backward shift of the following elements of the cluster.
+  std::size_t next = (index + 1) & m_mask;
+  while (m_slots[next].m_key != EmptyKey)
+  {
+    std::size_t ideal = hash (m_slots[next].m_key) & m_mask;
+    // Move the element if its ideal slot is not in the cyclic range ]index, next].
+    if (((next - ideal) & m_mask) >= ((next - index) & m_mask))
+    {
+      m_slots[index] = m_slots[next];
+      index          = next;
+    }
+
+    next = (next + 1) & m_mask;
+  }
+
+  m_slots[index].m_key   = EmptyKey;
+  m_slots[index].m_value = T ();
+  --m_size;
+  return true;
+}
+
+template<typename T>
+template<typename TPredicate>
+std::size_t CFlatHash<T>::removeIf (TPredicate predicate)
+{
+  std::vector<TKey> keys;
+  for (SSlot const & slot : m_slots)
+  {
+    if (slot.m_key != EmptyKey && predicate (slot.m_key, slot.m_value))
+    {
+      keys.push_back (slot.m_key);
+    }
+  }
+
+  for (TKey key : keys)
+  {
+    remove (key);
+  }
+
+  return keys.size ();
+}
+
+template<typename T>
+template<typename TFunction>
+void CFlatHash<T>::forEach (TFunction function) const
+{
+  for (SSlot const & slot : m_slots)
+  {
+    if (slot.m_key != EmptyKey)
+    {
+      function (slot.m_key, slot.m_value);
+    }
+  }
+}
+
+template<typename T>
+void CFlatHash<T>::clear ()
+{
+  for (SSlot& slot : m_slots)
+  {
+    slot.m_key   = EmptyKey;
+    slot.m_value = T ();
+  }
+
+  m_size = 0;
+}
+
+template<typename T>
+void CFlatHash<T>::reserve (std::size_t count)
+{
+  std::size_t capacity = m_slots.size ();
+  while (count * 2 > capacity)
+  {
+    capacity <<= 1;
+  }
+
+  if (capacity != m_slots.size ())
+  {
+    rehash (capacity);
+  }
+}
+
+template<typename T>
+void CFlatHash<T>::rehash (std::size_t capacity)
+{
+  std::vector<SSlot> slots (capacity);
+  m_slots.swap (slots);
+  m_mask = capacity - 1;
+  for (SSlot& slot : slots)
+  {
+    if (slot.m_key != EmptyKey)
+    {
+      m_slots[slotIndex (slot.m_key)] = slot;
+    }
+  }
+}
+
+#endif // FLATHASH_HPP
@@ -0,0 +1,427 @@
+﻿#include "inflater.hpp"
+#include <cstring>
+
+// Base values and extra bits of the length (257..285) and distance (0..29) symbols.
+static short const LengthBases[29]    = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                          35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static short const LengthExtras[29]   = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                          3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static short const DistanceBases[30]  = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385,
+                                          513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static short const DistanceExtras[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7,
+                                          8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+bool CInflater::isCompressed (std::uint8_t const * data, std::size_t size)
+{
+  bool compressed = false;
+  if (size >= 2)
+  {
+    if (data[0] == 0x1f && data[1] == 0x8b)
+    { // gzip
+      compressed = true;
+    }
+    else
+    { // zlib: deflate method, window up to 32K, header checksum.
+      compressed = (data[0] & 0x0f) == 8 && (data[0] >> 4) <= 7 && ((data[0] << 8) | data[1]) % 31 == 0;
+    }
+  }
+
+  return compressed;
+}
+
+bool CInflater::uncompress (std::uint8_t const * data, std::size_t size, std::vector<std::uint8_t>& out)
+{
+  out.clear ();
+  if (!isCompressed (data, size))
+  {
+    return false;
+  }
+
+  std::size_t pos = 0;
+  bool        gzip = data[0] == 0x1f;
+  if (gzip)
+  {
+    if (size < 18 || data[2] != 8)
+    {
+      return false;
+    }
+
+    int flags = data[3];
+    pos       = 10;
+    if ((flags & 4) != 0)
+    { // Extra field.
+      if (pos + 2 > size)
+      {
+        return false;
+      }
+
+      pos += 2 + (data[pos] | (data[pos + 1] << 8));
+    }
+
+    for (int flag = 8; flag <= 16; flag <<= 1)
+    { // Zero terminated file name and comment.
+      if ((flags & flag) != 0)
+      {
+        while (pos < size && data[pos] != 0)
+        {
+          ++pos;
+        }
+
+        ++pos;
+      }
+    }
+
+    if ((flags & 2) != 0)
+    { // Header crc.
+      pos += 2;
+    }
+  }
+  else
+  {
+    if ((data[1] & 0x20) != 0)
+    { // Preset dictionary.
+      return false;
+    }
+
+    pos = 2;
+  }
+
+  if (pos >= size)
+  {
+    return false;
+  }
+
+  out.reserve (size * 4);
+  CInflater inflater (data + pos, size - pos, out);
+  bool      ok = inflater.inflate ();
+  if (ok && gzip)
+  { // The trailer ends by the uncompressed size modulo 2^32.
+    std::uint8_t const * trailer = data + size - 4;
+    std::uint32_t        length  = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | (static_cast<std::uint32_t>(trailer[3]) << 24);
+    ok                           = length == static_cast<std::uint32_t>(out.size ());
+  }
+
+  return ok;
+}
+
+bool CInflater::inflate ()
+{
+  bool ok   = true;
+  bool last = false;
+  while (ok && !last)
+  {
+    last = bits (1) != 0;
+    switch (bits (2))
+    {
+      case 0 :
+        ok = stored ();
+        break;
+
+      case 1 :
+        ok = fixed ();
+        break;
+
+      case 2 :
+        ok = dynamic ();
+        break;
+
+      default :
+        ok = false;
+        break;
+    }
+
+    ok = ok && !m_error;
+  }
+
+  return ok;
+}
+
+int CInflater::bits (int count)
+{
+  std::uint32_t buffer = m_bitBuffer;
+  while (m_bitCount < count)
+  {
+    if (m_pos == m_size)
+    {
+      m_error = true;
+      return 0;
+    }
+
+    buffer     |= static_cast<std::uint32_t>(m_data[m_pos++]) << m_bitCount;
+    m_bitCount += 8;
+  }
+
+  m_bitBuffer  = buffer >> count;
+  m_bitCount  -= count;
+  return static_cast<int>(buffer & ((1u << count) - 1));
+}
+
+bool CInflater::stored ()
+{
+  // The block starts at the next byte.
+  m_bitBuffer = 0;
+  m_bitCount  = 0;
+  if (m_pos + 4 > m_size)
+  {
+    return false;
+  }
+
+  unsigned length  = m_data[m_pos] | (m_data[m_pos + 1] << 8);
+  unsigned nlength = m_data[m_pos + 2] | (m_data[m_pos + 3] << 8);
+  m_pos           += 4;
+  if (length != (~nlength & 0xffff) || m_pos + length > m_size)
+  {
+    return false;
+  }
+
+  m_out.insert (m_out.end (), m_data + m_pos, m_data + m_pos + length);
+  m_pos += length;
+  return true;
+}
+
+int CInflater::decode (SHuffman const & huffman)
+{
+  // The codes of a length are consecutive integers, first is the first code of the length.
+  int code  = 0;
+  int first = 0;
+  int index = 0;
+  for (int length = 1; length < 16; ++length)
+  {
+    code      |= bits (1);
+    int count  = huffman.m_counts[length];
+    if (code - count < first)
+    {
+      return huffman.m_symbols[index + code - first];
+    }
+
+    index  += count;
+    first  += count;
+    first <<= 1;
+    code  <<= 1;
+  }
+
+  return -1;
+}
+
+int CInflater::construct (SHuffman& huffman, short const * lengths, int count)
+{
+  std::memset (huffman.m_counts, 0, sizeof (huffman.m_counts));
+  for (int symbol = 0; symbol < count; ++symbol)
+  {
+    ++huffman.m_counts[lengths[symbol]];
+  }
+
+  if (huffman.m_counts[0] == count)
+  { // No code.
+    return 0;
+  }
+
+  // Number of unused codes. Negative for an over-subscribed set, positive for an incomplete set.
+  int left = 1;
+  for (int length = 1; length < 16; ++length)
+  {
+    left <<= 1;
+    left  -= huffman.m_counts[length];
+    if (left < 0)
+    {
+      return left;
+    }
+  }
+
+  short offsets[16];
+  offsets[1] = 0;
+  for (int length = 1; length < 15; ++length)
+  {
+    offsets[length + 1] = offsets[length] + huffman.m_counts[length];
+  }
+
+  for (int symbol = 0; symbol < count; ++symbol)
+  {
+    if (lengths[symbol] != 0)
+    {
+      huffman.m_symbols[offsets[lengths[symbol]]++] = static_cast<short>(symbol);
+    }
+  }
+
+  return left;
+}
+
+bool CInflater::codes (SHuffman const & lengthCode, SHuffman const & distanceCode)
+{
+  for (;;)
+  {
+    int symbol = decode (lengthCode);
+    if (symbol < 0 || m_error)
+    {
+      return false;
+    }
+
+    if (symbol < 256)
+    {
+      m_out.push_back (static_cast<std::uint8_t>(symbol));
+    }
+    else if (symbol == 256)
+    { // End of block.
+      return true;
+    }
+    else
+    {
+      symbol -= 257;
+      if (symbol >= 29)
+      {
+        return false;
+      }
+
+      std::size_t length = LengthBases[symbol] + bits (LengthExtras[symbol]);
+      symbol             = decode (distanceCode);
+      if (symbol < 0 || symbol >= 30)
+      {
+        return false;
+      }
+
+      std::size_t distance = DistanceBases[symbol] + bits (DistanceExtras[symbol]);
+      std::size_t size     = m_out.size ();
+      if (distance > size || m_error)
+      {
+        return false;
+      }
+
+      // The copy can overlap the bytes it writes (e.g. distance 1 repeats the last byte).
+      m_out.resize (size + length);
+      std::uint8_t*        out  = m_out.data () + size;
+      std::uint8_t const * from = out - distance;
+      for (std::size_t i = 0; i < length; ++i)
+      {
+        out[i] = from[i];
+      }
+    }
+  }
+}
+
+bool CInflater::fixed ()
+{
+  SHuffman lengthCode, distanceCode;
+  short    lengths[288];
+  int      symbol = 0;
+  for (; symbol < 144; ++symbol)
+  {
+    lengths[symbol] = 8;
+  }
+
+  for (; symbol < 256; ++symbol)
+  {
+    lengths[symbol] = 9;
+  }
+
+  for (; symbol < 280; ++symbol)
+  {
+    lengths[symbol] = 7;
+  }
+
+  for (; symbol < 288; ++symbol)
+  {
+    lengths[symbol] = 8;
+  }
+
+  construct (lengthCode, lengths, 288);
+  for (symbol = 0; symbol < 30; ++symbol)
+  {
+    lengths[symbol] = 5;
+  }
+
+  construct (distanceCode, lengths, 30);
+  return codes (lengthCode, distanceCode);
+}
+
+bool CInflater::dynamic ()
+{
+  static int const Order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+  int lengthCount   = bits (5) + 257;
+  int distanceCount = bits (5) + 1;
+  int codeCount     = bits (4) + 4;
+  if (lengthCount > 286 || distanceCount > 30 || m_error)
+  {
+    return false;
+  }
+
+  // The code lengths are themselves Huffman coded.
+  SHuffman lengthCode, distanceCode;
+  short    lengths[320] = {};
+  for (int i = 0; i < codeCount; ++i)
+  {
+    lengths[Order[i]] = static_cast<short>(bits (3));
+  }
+
+  if (construct (lengthCode, lengths, 19) != 0)
+  {
+    return false;
+  }
+
+  int index = 0;
+  while (index < lengthCount + distanceCount)
+  {
+    int symbol = decode (lengthCode);
+    if (symbol < 0 || m_error)
+    {
+      return false;
+    }
+
+    if (symbol < 16)
+    {
+      lengths[index++] = static_cast<short>(symbol);
+    }
+    else
+    { // Repeat the previous length or zero.
+      short length = 0;
+      if (symbol == 16)
+      {
+        if (index == 0)
+        {
+          return false;
+        }
+
+        length = lengths[index - 1];
+        symbol = 3 + bits (2);
+      }
+      else if (symbol == 17)
+      {
+        symbol = 3 + bits (3);
+      }
+      else
+      {
+        symbol = 11 + bits (7);
+      }
+
+      if (index + symbol > lengthCount + distanceCount)
+      {
+        return false;
+      }
+
+      while (symbol-- > 0)
+      {
+        lengths[index++] = length;
+      }
+    }
+  }
+
+  if (lengths[256] == 0)
+  { // No end of block code.
+    return false;
+  }
+
+  // Incomplete codes are only allowed for a single code.
+  int left = construct (lengthCode, lengths, lengthCount);
+  if (left < 0 || (left > 0 && lengthCount - lengthCode.m_counts[0] != 1))
+  {
+    return false;
+  }
+
+  left = construct (distanceCode, lengths + lengthCount, distanceCount);
+  if (left < 0 || (left > 0 && distanceCount - distanceCode.m_counts[0] != 1))
+  {
+    return false;
+  }
+
+  return codes (lengthCode, distanceCode);
+}
@@ -0,0 +1,60 @@
+﻿#ifndef INFLATER_HPP
+#define INFLATER_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/*! \brief The CInflater class uncompresses the gzip and zlib streams (deflate, RFC 1950 to 1952).
+ *
+ *  It is used for the data compressed by the tile producers (e.g. the vector tiles of the MBTiles files)
+ *  and not uncompressed by the network layer. Qt provides only qUncompress which needs a zlib stream
+ *  preceded by its uncompressed size. The decoder is the canonical Huffman decoder of the deflate
+ *  specification, read bit by bit. It is fast enough for data of some hundred kilobytes.
+ *  The checksums of the streams are not verified, the uncompressed size of gzip streams is.
+ */
+class CInflater
+{
+public:
+  /*! Returns true if data starts with a gzip or a zlib header. */
+  static bool isCompressed (std::uint8_t const * data, std::size_t size);
+
+  /*! Uncompresses a gzip or a zlib stream.
+   *  \param data: The compressed stream.
+   *  \param size: The size of the stream in bytes.
+   *  \param out: The uncompressed data. Its previous content is replaced.
+   *  \return false if the stream is not valid.
+   */
+  static bool uncompress (std::uint8_t const * data, std::size_t size, std::vector<std::uint8_t>& out);
+
+private:
+  /*! Canonical Huffman code. */
+  struct SHuffman
+  {
+    short m_counts[16];   //!< Number of symbols of each code length.
+    short m_symbols[288]; //!< Symbols ordered by code.
+  };
+
+  CInflater (std::uint8_t const * data, std::size_t size, std::vector<std::uint8_t>& out) :
+    m_data (data), m_size (size), m_out (out) {}
+
+  bool inflate ();
+  bool stored ();
+  bool fixed ();
+  bool dynamic ();
+  bool codes (SHuffman const & lengthCode, SHuffman const & distanceCode);
+  int bits (int count);
+  int decode (SHuffman const & huffman);
+  static int construct (SHuffman& huffman, short const * lengths, int count);
+
+private:
+  std::uint8_t const *       m_data;              //!< The compressed stream.
+  std::size_t                m_size;              //!< The size of the compressed stream.
+  std::size_t                m_pos       = 0;     //!< The next byte to read.
+  std::uint32_t              m_bitBuffer = 0;     //!< Bits read and not used.
+  int                        m_bitCount  = 0;     //!< Number of bits in m_bitBuffer.
+  bool                       m_error     = false; //!< The stream is truncated.
+  std::vector<std::uint8_t>& m_out;               //!< The uncompressed data.
+};
+
+#endif // INFLATER_HPP
@@ -0,0 +1,432 @@
+﻿#include "mercator.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__)
+#define MERCATOR_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MERCATOR_SSE2
+#include <emmintrin.h>
+#endif
+
+/*! Taylor coefficients of the approximations. The number of terms gives the precision of the type
+ *  on the reduced ranges: sin and cos on [0, pi/4], log on [sqrt(1/2), sqrt(2)], exp on
+ *  [-ln(2)/2, ln(2)/2] and atan on [0, 0.2].
+ */
+template<typename T>
+struct SCoefficients;
+
+template<>
+struct SCoefficients<double>
+{
+  enum ECount { Sin = 9, Cos = 9, Log = 11, Exp = 14, Atan = 11 };
+
+  static double const m_sin[Sin];   //!< x^(2k+1) coefficients (-1)^k / (2k+1)!
+  static double const m_cos[Cos];   //!< x^2k coefficients (-1)^k / (2k)!
+  static double const m_log[Log];   //!< f^2k coefficients of log ((1+f)/(1-f)) / 2f.
+  static double const m_exp[Exp];   //!< x^k coefficients 1 / k!
+  static double const m_atan[Atan]; //!< x^(2k+1) coefficients (-1)^k / (2k+1)
+  static double const m_ln2Hi, m_ln2Lo; //!< ln (2) split to reduce exactly k * ln (2).
+};
+
+template<>
+struct SCoefficients<float>
+{
+  enum ECount { Sin = 5, Cos = 5, Log = 5, Exp = 8, Atan = 5 };
+
+  static float const m_sin[Sin];
+  static float const m_cos[Cos];
+  static float const m_log[Log];
+  static float const m_exp[Exp];
+  static float const m_atan[Atan];
+  static float const m_ln2Hi, m_ln2Lo;
+};
+
+double const SCoefficients<double>::m_sin[]  = { 1.0, -1.0 / 6, 1.0 / 120, -1.0 / 5040, 1.0 / 362880, -1.0 / 39916800,
+                                                 1.0 / 6227020800.0, -1.0 / 1307674368000.0, 1.0 / 355687428096000.0 };
+double const SCoefficients<double>::m_cos[]  = { 1.0, -1.0 / 2, 1.0 / 24, -1.0 / 720, 1.0 / 40320, -1.0 / 3628800,
+                                                 1.0 / 479001600, -1.0 / 87178291200.0, 1.0 / 20922789888000.0 };
+double const SCoefficients<double>::m_log[]  = { 1.0, 1.0 / 3, 1.0 / 5, 1.0 / 7, 1.0 / 9, 1.0 / 11, 1.0 / 13, 1.0 / 15,
+                                                 1.0 / 17, 1.0 / 19, 1.0 / 21 };
+double const SCoefficients<double>::m_exp[]  = { 1.0, 1.0, 1.0 / 2, 1.0 / 6, 1.0 / 24, 1.0 / 120, 1.0 / 720, 1.0 / 5040,
+                                                 1.0 / 40320, 1.0 / 362880, 1.0 / 3628800, 1.0 / 39916800,
+                                                 1.0 / 479001600, 1.0 / 6227020800.0 };
+double const SCoefficients<double>::m_atan[] = { 1.0, -1.0 / 3, 1.0 / 5, -1.0 / 7, 1.0 / 9, -1.0 / 11, 1.0 / 13, -1.0 / 15,
+                                                 1.0 / 17, -1.0 / 19, 1.0 / 21 };
+double const SCoefficients<double>::m_ln2Hi  = 6.93147180369123816490e-01;
+double const SCoefficients<double>::m_ln2Lo  = 1.90821492927058770002e-10;
+
+float const SCoefficients<float>::m_sin[]  = { 1.0f, -1.0f / 6, 1.0f / 120, -1.0f / 5040, 1.0f / 362880 };
+float const SCoefficients<float>::m_cos[]  = { 1.0f, -1.0f / 2, 1.0f / 24, -1.0f / 720, 1.0f / 40320 };
+float const SCoefficients<float>::m_log[]  = { 1.0f, 1.0f / 3, 1.0f / 5, 1.0f / 7, 1.0f / 9 };
+float const SCoefficients<float>::m_exp[]  = { 1.0f, 1.0f, 1.0f / 2, 1.0f / 6, 1.0f / 24, 1.0f / 120, 1.0f / 720, 1.0f / 5040 };
+float const SCoefficients<float>::m_atan[] = { 1.0f, -1.0f / 3, 1.0f / 5, -1.0f / 7, 1.0f / 9 };
+float const SCoefficients<float>::m_ln2Hi  = 0.693145751953125f;
+float const SCoefficients<float>::m_ln2Lo  = 1.428606765330187045e-06f;
+
+/*! Scalar operations. Used on all processors for the ends of the arrays. */
+template<typename T>
+struct SScalar
+{
+  using TScalar = T;
+  using TVec    = T;
+  using TMask   = bool;
+  enum ESize { Size = 1 };
+
+  static TVec load (T const * p) { return *p; }
+  static void store (T* p, TVec a) { *p = a; }
+  static TVec set (T a) { return a; }
+  static TVec add (TVec a, TVec b) { return a + b; }
+  static TVec sub (TVec a, TVec b) { return a - b; }
+  static TVec mul (TVec a, TVec b) { return a * b; }
+  static TVec div (TVec a, TVec b) { return a / b; }
+  static TVec sqrt (TVec a) { return std::sqrt (a); }
+  static TVec min (TVec a, TVec b) { return std::min (a, b); }
+  static TVec max (TVec a, TVec b) { return std::max (a, b); }
+  static TVec abs (TVec a) { return std::fabs (a); }
+  static TVec copySign (TVec a, TVec sign) { return std::copysign (a, sign); }
+  static TMask greater (TVec a, TVec b) { return a > b; }
+  static TVec select (TMask mask, TVec a, TVec b) { return mask ? a : b; }
+  static TVec round (TVec a) { return std::nearbyint (a); }
+  static TVec pow2 (TVec k) { return std::ldexp (static_cast<T>(1), static_cast<int>(k)); }
+
+  /*! Splits a positive normal number x in m * 2^e, m in [1, 2). */
+  static void split (TVec x, TVec& e, TVec& m)
+  {
+    int exponent;
+    m = std::frexp (x, &exponent) * 2;
+    e = static_cast<T>(exponent - 1);
+  }
+};
+
+#ifdef MERCATOR_SSE2
+/*! SSE2 operations on 2 doubles. */
+struct SSse2Double
+{
+  using TScalar = double;
+  using TVec    = __m128d;
+  using TMask   = __m128d;
+  enum ESize { Size = 2 };
+
+  static TVec load (double const * p) { return _mm_loadu_pd (p); }
+  static void store (double* p, TVec a) { _mm_storeu_pd (p, a); }
+  static TVec set (double a) { return _mm_set1_pd (a); }
+  static TVec add (TVec a, TVec b) { return _mm_add_pd (a, b); }
+  static TVec sub (TVec a, TVec b) { return _mm_sub_pd (a, b); }
+  static TVec mul (TVec a, TVec b) { return _mm_mul_pd (a, b); }
+  static TVec div (TVec a, TVec b) { return _mm_div_pd (a, b); }
+  static TVec sqrt (TVec a) { return _mm_sqrt_pd (a); }
+  static TVec min (TVec a, TVec b) { return _mm_min_pd (a, b); }
+  static TVec max (TVec a, TVec b) { return _mm_max_pd (a, b); }
+  static TVec abs (TVec a) { return _mm_andnot_pd (_mm_set1_pd (-0.0), a); }
+  static TVec copySign (TVec a, TVec sign) { return _mm_or_pd (abs (a), _mm_and_pd (_mm_set1_pd (-0.0), sign)); }
+  static TMask greater (TVec a, TVec b) { return _mm_cmpgt_pd (a, b); }
+  static TVec select (TMask mask, TVec a, TVec b) { return _mm_or_pd (_mm_and_pd (mask, a), _mm_andnot_pd (mask, b)); }
+
+  // Adding 1.5 * 2^52 rounds to an integer stored in the low bits of the mantissa.
+  static TVec round (TVec a)
+  {
+    TVec magic = _mm_set1_pd (6755399441055744.0);
+    return _mm_sub_pd (_mm_add_pd (a, magic), magic);
+  }
+
+  static TVec pow2 (TVec k)
+  {
+    __m128i bits = _mm_castpd_si128 (_mm_add_pd (k, _mm_set1_pd (6755399441055744.0)));
+    return _mm_castsi128_pd (_mm_slli_epi64 (_mm_add_epi64 (bits, _mm_set1_epi64x (1023)), 52));
+  }
+
+  static void split (TVec x, TVec& e, TVec& m)
+  {
+    __m128i bits     = _mm_castpd_si128 (x);
+    __m128i exponent = _mm_or_si128 (_mm_srli_epi64 (bits, 52), _mm_set1_epi64x (0x4330000000000000));
+    e                = _mm_sub_pd (_mm_castsi128_pd (exponent), _mm_set1_pd (4503599627370496.0 + 1023));
+    m                = _mm_castsi128_pd (_mm_or_si128 (_mm_and_si128 (bits, _mm_set1_epi64x (0x000FFFFFFFFFFFFF)),
+                                                       _mm_set1_epi64x (0x3FF0000000000000)));
+  }
+};
+
+/*! SSE2 operations on 4 floats. */
+struct SSse2Float
+{
+  using TScalar = float;
+  using TVec    = __m128;
+  using TMask   = __m128;
+  enum ESize { Size = 4 };
+
+  static TVec load (float const * p) { return _mm_loadu_ps (p); }
+  static void store (float* p, TVec a) { _mm_storeu_ps (p, a); }
+  static TVec set (float a) { return _mm_set1_ps (a); }
+  static TVec add (TVec a, TVec b) { return _mm_add_ps (a, b); }
+  static TVec sub (TVec a, TVec b) { return _mm_sub_ps (a, b); }
+  static TVec mul (TVec a, TVec b) { return _mm_mul_ps (a, b); }
+  static TVec div (TVec a, TVec b) { return _mm_div_ps (a, b); }
+  static TVec sqrt (TVec a) { return _mm_sqrt_ps (a); }
+  static TVec min (TVec a, TVec b) { return _mm_min_ps (a, b); }
+  static TVec max (TVec a, TVec b) { return _mm_max_ps (a, b); }
+  static TVec abs (TVec a) { return _mm_andnot_ps (_mm_set1_ps (-0.0f), a); }
+  static TVec copySign (TVec a, TVec sign) { return _mm_or_ps (abs (a), _mm_and_ps (_mm_set1_ps (-0.0f), sign)); }
+  static TMask greater (TVec a, TVec b) { return _mm_cmpgt_ps (a, b); }
+  static TVec select (TMask mask, TVec a, TVec b) { return _mm_or_ps (_mm_and_ps (mask, a), _mm_andnot_ps (mask, b)); }
+  static TVec round (TVec a) { return _mm_cvtepi32_ps (_mm_cvtps_epi32 (a)); }
+
+  static TVec pow2 (TVec k)
+  {
+    return _mm_castsi128_ps (_mm_slli_epi32 (_mm_add_epi32 (_mm_cvtps_epi32 (k), _mm_set1_epi32 (127)), 23));
+  }
+
+  static void split (TVec x, TVec& e, TVec& m)
+  {
+    __m128i bits = _mm_castps_si128 (x);
+    e            = _mm_cvtepi32_ps (_mm_sub_epi32 (_mm_srli_epi32 (bits, 23), _mm_set1_epi32 (127)));
+    m            = _mm_castsi128_ps (_mm_or_si128 (_mm_and_si128 (bits, _mm_set1_epi32 (0x007FFFFF)),
+                                                   _mm_set1_epi32 (0x3F800000)));
+  }
+};
+#endif // MERCATOR_SSE2
+
+#ifdef MERCATOR_AVX2
+/*! AVX2 operations on 4 doubles. */
+struct SAvx2Double
+{
+  using TScalar = double;
+  using TVec    = __m256d;
+  using TMask   = __m256d;
+  enum ESize { Size = 4 };
+
+  static TVec load (double const * p) { return _mm256_loadu_pd (p); }
+  static void store (double* p, TVec a) { _mm256_storeu_pd (p, a); }
+  static TVec set (double a) { return _mm256_set1_pd (a); }
+  static TVec add (TVec a, TVec b) { return _mm256_add_pd (a, b); }
+  static TVec sub (TVec a, TVec b) { return _mm256_sub_pd (a, b); }
+  static TVec mul (TVec a, TVec b) { return _mm256_mul_pd (a, b); }
+  static TVec div (TVec a, TVec b) { return _mm256_div_pd (a, b); }
+  static TVec sqrt (TVec a) { return _mm256_sqrt_pd (a); }
+  static TVec min (TVec a, TVec b) { return _mm256_min_pd (a, b); }
+  static TVec max (TVec a, TVec b) { return _mm256_max_pd (a, b); }
+  static TVec abs (TVec a) { return _mm256_andnot_pd (_mm256_set1_pd (-0.0), a); }
+  static TVec copySign (TVec a, TVec sign) { return _mm256_or_pd (abs (a), _mm256_and_pd (_mm256_set1_pd (-0.0), sign)); }
+  static TMask greater (TVec a, TVec b) { return _mm256_cmp_pd (a, b, _CMP_GT_OQ); }
+  static TVec select (TMask mask, TVec a, TVec b) { return _mm256_blendv_pd (b, a, mask); }
+  static TVec round (TVec a) { return _mm256_round_pd (a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+
+  static TVec pow2 (TVec k)
+  {
+    __m256i bits = _mm256_castpd_si256 (_mm256_add_pd (k, _mm256_set1_pd (6755399441055744.0)));
+    return _mm256_castsi256_pd (_mm256_slli_epi64 (_mm256_add_epi64 (bits, _mm256_set1_epi64x (1023)), 52));
+  }
+
+  static void split (TVec x, TVec& e, TVec& m)
+  {
+    __m256i bits     = _mm256_castpd_si256 (x);
+    __m256i exponent = _mm256_or_si256 (_mm256_srli_epi64 (bits, 52), _mm256_set1_epi64x (0x4330000000000000));
+    e                = _mm256_sub_pd (_mm256_castsi256_pd (exponent), _mm256_set1_pd (4503599627370496.0 + 1023));
+    m                = _mm256_castsi256_pd (_mm256_or_si256 (_mm256_and_si256 (bits, _mm256_set1_epi64x (0x000FFFFFFFFFFFFF)),
+                                                             _mm256_set1_epi64x (0x3FF0000000000000)));
+  }
+};
+
+/*! AVX2 operations on 8 floats. */
+struct SAvx2Float
+{
+  using TScalar = float;
+  using TVec    = __m256;
+  using TMask   = __m256;
+  enum ESize { Size = 8 };
+
+  static TVec load (float const * p) { return _mm256_loadu_ps (p); }
+  static void store (float* p, TVec a) { _mm256_storeu_ps (p, a); }
+  static TVec set (float a) { return _mm256_set1_ps (a); }
+  static TVec add (TVec a, TVec b) { return _mm256_add_ps (a, b); }
+  static TVec sub (TVec a, TVec b) { return _mm256_sub_ps (a, b); }
+  static TVec mul (TVec a, TVec b) { return _mm256_mul_ps (a, b); }
+  static TVec div (TVec a, TVec b) { return _mm256_div_ps (a, b); }
+  static TVec sqrt (TVec a) { return _mm256_sqrt_ps (a); }
+  static TVec min (TVec a, TVec b) { return _mm256_min_ps (a, b); }
+  static TVec max (TVec a, TVec b) { return _mm256_max_ps (a, b); }
+  static TVec abs (TVec a) { return _mm256_andnot_ps (_mm256_set1_ps (-0.0f), a); }
+  static TVec copySign (TVec a, TVec sign) { return _mm256_or_ps (abs (a), _mm256_and_ps (_mm256_set1_ps (-0.0f), sign)); }
+  static TMask greater (TVec a, TVec b) { return _mm256_cmp_ps (a, b, _CMP_GT_OQ); }
+  static TVec select (TMask mask, TVec a, TVec b) { return _mm256_blendv_ps (b, a, mask); }
+  static TVec round (TVec a) { return _mm256_round_ps (a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+
+  static TVec pow2 (TVec k)
+  {
+    return _mm256_castsi256_ps (_mm256_slli_epi32 (_mm256_add_epi32 (_mm256_cvtps_epi32 (k), _mm256_set1_epi32 (127)), 23));
+  }
+
+  static void split (TVec x, TVec& e, TVec& m)
+  {
+    __m256i bits = _mm256_castps_si256 (x);
+    e            = _mm256_cvtepi32_ps (_mm256_sub_epi32 (_mm256_srli_epi32 (bits, 23), _mm256_set1_epi32 (127)));
+    m            = _mm256_castsi256_ps (_mm256_or_si256 (_mm256_and_si256 (bits, _mm256_set1_epi32 (0x007FFFFF)),
+                                                         _mm256_set1_epi32 (0x3F800000)));
+  }
+};
+#endif // MERCATOR_AVX2
+
+/*! Evaluates the polynomial of coefficients c[0..count[ at x by the Horner method. */
+template<typename V>
+static inline typename V::TVec polynomial (typename V::TVec x, typename V::TScalar const * c, int count)
+{
+  typename V::TVec p = V::set (c[count - 1]);
+  for (int k = count - 2; k >= 0; --k)
+  {
+    p = V::add (V::mul (p, x), V::set (c[k]));
+  }
+
+  return p;
+}
+
+/*! Returns the natural logarithm of a positive normal number. */
+template<typename V>
+static inline typename V::TVec log (typename V::TVec x)
+{
+  using T  = typename V::TScalar;
+  using C  = SCoefficients<T>;
+  using TV = typename V::TVec;
+
+  // x = m * 2^e with m in [sqrt(1/2), sqrt(2)[, then log (m) = log ((1+f)/(1-f)) with f = (m-1)/(m+1).
+  TV e, m;
+  V::split (x, e, m);
+  typename V::TMask big = V::greater (m, V::set (static_cast<T>(1.41421356237309504880)));
+  m                     = V::select (big, V::mul (m, V::set (static_cast<T>(0.5))), m);
+  e                     = V::select (big, V::add (e, V::set (1)), e);
+
+  TV f  = V::div (V::sub (m, V::set (1)), V::add (m, V::set (1)));
+  TV lm = V::mul (V::mul (V::set (2), f), polynomial<V> (V::mul (f, f), C::m_log, C::Log));
+  return V::add (V::add (V::mul (e, V::set (C::m_ln2Lo)), lm), V::mul (e, V::set (C::m_ln2Hi)));
+}
+
+/*! Returns the exponential of a number in [-40, 0]. */
+template<typename V>
+static inline typename V::TVec exp (typename V::TVec x)
+{
+  using T  = typename V::TScalar;
+  using C  = SCoefficients<T>;
+  using TV = typename V::TVec;
+
+  // exp (x) = 2^k * exp (r) with |r| <= ln(2)/2.
+  TV k = V::round (V::mul (x, V::set (static_cast<T>(1.44269504088896340736))));
+  TV r = V::sub (V::sub (x, V::mul (k, V::set (C::m_ln2Hi))), V::mul (k, V::set (C::m_ln2Lo)));
+  return V::mul (polynomial<V> (r, C::m_exp, C::Exp), V::pow2 (k));
+}
+
+/*! Returns the arc tangent of a number in [0, 1]. */
+template<typename V>
+static inline typename V::TVec atan (typename V::TVec x)
+{
+  using C  = SCoefficients<typename V::TScalar>;
+  using TV = typename V::TVec;
+
+  // atan (x) = 2 atan (x / (1 + sqrt (1 + x^2))), applied twice to reduce x to [0, 0.2].
+  TV one = V::set (1);
+  x      = V::div (x, V::add (one, V::sqrt (V::add (one, V::mul (x, x)))));
+  x      = V::div (x, V::add (one, V::sqrt (V::add (one, V::mul (x, x)))));
+  return V::mul (V::set (4), V::mul (x, polynomial<V> (V::mul (x, x), C::m_atan, C::Atan)));
+}
+
+/*! Returns ln (tan (pi/4 + latitude/2)) of latitudes in degrees.
+ *  With g = pi/4 - |latitude|/2, the ordinate is +/-ln (cos (g) / sin (g)). g is computed from
+ *  90 - |latitude| which is exact near the poles, where the ordinate is the most sensitive.
+ */
+template<typename V>
+static inline typename V::TVec ordinate (typename V::TVec latitude)
+{
+  using T  = typename V::TScalar;
+  using C  = SCoefficients<T>;
+  using TV = typename V::TVec;
+
+  TV g  = V::sub (V::set (90), V::min (V::abs (latitude), V::set (static_cast<T>(89.99))));
+  g     = V::mul (g, V::set (static_cast<T>(3.14159265358979323846 / 360)));
+  TV g2 = V::mul (g, g);
+  TV r  = V::div (polynomial<V> (g2, C::m_cos, C::Cos), V::mul (g, polynomial<V> (g2, C::m_sin, C::Sin)));
+  return V::copySign (log<V> (r), latitude);
+}
+
+/*! Returns atan (sinh (ordinate)) in degrees, computed as +/-(pi/2 - 2 atan (exp (-|ordinate|))). */
+template<typename V>
+static inline typename V::TVec latitude (typename V::TVec ordinate)
+{
+  using T  = typename V::TScalar;
+  using TV = typename V::TVec;
+
+  TV a   = V::min (V::abs (ordinate), V::set (40));
+  TV phi = V::sub (V::set (static_cast<T>(1.57079632679489661923)), V::mul (V::set (2), atan<V> (exp<V> (V::sub (V::set (0), a)))));
+  return V::mul (V::copySign (phi, ordinate), V::set (static_cast<T>(180 / 3.14159265358979323846)));
+}
+
+/*! Computes the ordinates of the largest multiple of V::Size values and returns this number. */
+template<typename V>
+static int ordinates (typename V::TScalar const * latitudes, typename V::TScalar* ordinates, int count)
+{
+  int i = 0;
+  for (; i + V::Size <= count; i += V::Size)
+  {
+    V::store (ordinates + i, ordinate<V> (V::load (latitudes + i)));
+  }
+
+  return i;
+}
+
+/*! Computes the latitudes of the largest multiple of V::Size values and returns this number. */
+template<typename V>
+static int latitudes (typename V::TScalar const * ordinates, typename V::TScalar* latitudes, int count)
+{
+  int i = 0;
+  for (; i + V::Size <= count; i += V::Size)
+  {
+    V::store (latitudes + i, latitude<V> (V::load (ordinates + i)));
+  }
+
+  return i;
+}
+
+void CMercator::ordinates (double const * latitudes, double* ordinates, int count)
+{
+#if defined(MERCATOR_AVX2)
+  int i = ::ordinates<SAvx2Double> (latitudes, ordinates, count);
+#elif defined(MERCATOR_SSE2)
+  int i = ::ordinates<SSse2Double> (latitudes, ordinates, count);
+#else
+  int i = 0;
+#endif
+  ::ordinates<SScalar<double>> (latitudes + i, ordinates + i, count - i);
+}
+
+void CMercator::ordinates (float const * latitudes, float* ordinates, int count)
+{
+#if defined(MERCATOR_AVX2)
+  int i = ::ordinates<SAvx2Float> (latitudes, ordinates, count);
+#elif defined(MERCATOR_SSE2)
+  int i = ::ordinates<SSse2Float> (latitudes, ordinates, count);
+#else
+  int i = 0;
+#endif
+  ::ordinates<SScalar<float>> (latitudes + i, ordinates + i, count - i);
+}
+
+void CMercator::latitudes (double const * ordinates, double* latitudes, int count)
+{
+#if defined(MERCATOR_AVX2)
+  int i = ::latitudes<SAvx2Double> (ordinates, latitudes, count);
+#elif defined(MERCATOR_SSE2)
+  int i = ::latitudes<SSse2Double> (ordinates, latitudes, count);
+#else
+  int i = 0;
+#endif
+  ::latitudes<SScalar<double>> (ordinates + i, latitudes + i, count - i);
+}
+
+void CMercator::latitudes (float const * ordinates, float* latitudes, int count)
+{
+#if defined(MERCATOR_AVX2)
+  int i = ::latitudes<SAvx2Float> (ordinates, latitudes, count);
+#elif defined(MERCATOR_SSE2)
+  int i = ::latitudes<SSse2Float> (ordinates, latitudes, count);
+#else
+  int i = 0;
+#endif
+  ::latitudes<SScalar<float>> (ordinates + i, latitudes + i, count - i);
+}
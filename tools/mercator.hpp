@@ -0,0 +1,47 @@
+﻿#ifndef MERCATOR_HPP
+#define MERCATOR_HPP
+
+/*! \brief The CMercator class computes the Web Mercator ordinates of arrays of latitudes and back.
+ *
+ *  The drawing and the import of shapes project millions of vertexes and the libm functions
+ *  (log, tan, atan, sinh) are evaluated one value at a time. These functions evaluate polynomial
+ *  approximations on SIMD registers: AVX2 when the compiler targets it (__AVX2__), SSE2 on x86
+ *  and x86-64, scalars on the other processors and for the ends of the arrays. The approximations
+ *  are the same on every path, so the results do not depend on the instruction set.
+ *
+ *  On the latitudes of the Web Mercator world [-85.06, 85.06], the absolute error is below 1e-14
+ *  in double and 1e-6 in float, the latitudes being measured in radians.
+ */
+class CMercator
+{
+public:
+  /*! Computes the Mercator ordinates ln (tan (pi / 4 + latitude / 2)) of latitudes.
+   *  \param latitudes: The latitudes in degrees. Clamped at +/-89.99 degrees.
+   *  \param ordinates: The ordinates. Can be the same array as latitudes.
+   *  \param count: The number of values.
+   */
+  static void ordinates (double const * latitudes, double* ordinates, int count);
+
+  /*! Computes the Mercator ordinates ln (tan (pi / 4 + latitude / 2)) of latitudes.
+   *  \param latitudes: The latitudes in degrees. Clamped at +/-89.99 degrees.
+   *  \param ordinates: The ordinates. Can be the same array as latitudes.
+   *  \param count: The number of values.
+   */
+  static void ordinates (float const * latitudes, float* ordinates, int count);
+
+  /*! Computes the latitudes atan (sinh (ordinate)) of Mercator ordinates.
+   *  \param ordinates: The ordinates.
+   *  \param latitudes: The latitudes in degrees. Can be the same array as ordinates.
+   *  \param count: The number of values.
+   */
+  static void latitudes (double const * ordinates, double* latitudes, int count);
+
+  /*! Computes the latitudes atan (sinh (ordinate)) of Mercator ordinates.
+   *  \param ordinates: The ordinates.
+   *  \param latitudes: The latitudes in degrees. Can be the same array as ordinates.
+   *  \param count: The number of values.
+   */
+  static void latitudes (float const * ordinates, float* latitudes, int count);
+};
+
+#endif // MERCATOR_HPP
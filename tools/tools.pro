@@ -10,13 +10,18 @@ include(../optimize.pri)
 
 SOURCES += \
     aabb.cpp \
-    ellipsehelper.cpp
+    ellipsehelper.cpp \
+    inflater.cpp \
+    mercator.cpp
 
 HEADERS += \
     aabb.hpp \
     ellipsehelper.hpp \
+    flathash.hpp \
+    inflater.hpp \
     kdtree.hpp \
     kdtree_impl.hpp \
+    mercator.hpp \
     status.hpp \
     tglobals.hpp \
     vector.hpp